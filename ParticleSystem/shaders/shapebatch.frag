@@ -0,0 +1,84 @@
+#version 330 core
+
+// Must match ShapeType in shapeinstances.hpp
+#define SHAPE_CIRCLE 0
+#define SHAPE_ELLIPSE 1
+#define SHAPE_RECT 2
+#define SHAPE_RECT_GRADIENT 3
+#define SHAPE_ROUNDED_RECT 4
+#define SHAPE_RING 5
+
+#define PI 3.14159265
+#define TAU 6.28318531
+
+in vec2 vLocal;
+in vec2 vHalfSize;
+flat in int vShape;
+in vec4 vParams;
+in vec4 vColor;
+in vec4 vSecondaryColor;
+
+out vec4 color;
+
+float box(vec2 p, vec2 halfSize) {
+    vec2 d = abs(p) - halfSize;
+    return length(max(d, 0.0)) + min(max(d.x, d.y), 0.0);
+}
+
+float roundedBox(vec2 p, vec2 halfSize, float radius) {
+    return box(p, halfSize - radius) - radius;
+}
+
+float ellipse(vec2 p, vec2 radii) {
+    // First order approximation, exact enough for particle sized ellipses
+    float k = length(p / radii);
+    return (k - 1.0) * min(radii.x, radii.y);
+}
+
+float ring(vec2 p, float outerRadius) {
+    float startAngle = vParams.x;
+    float endAngle = vParams.y;
+    float innerRadius = vParams.z * outerRadius;
+    float segments = vParams.w;
+
+    // Screen space y points down, angles grow clockwise like raylib's DrawRing
+    float angle = mod(atan(p.y, p.x) - startAngle, TAU);
+    if (angle > endAngle - startAngle) return 1.0;
+
+    // Regular polygon rings shrink the radius between vertices
+    float scale = 1.0;
+    if (segments >= 3.0) {
+        float step = TAU / segments;
+        scale = cos(step * 0.5) / cos(mod(angle, step) - step * 0.5);
+    }
+
+    float dist = length(p);
+    return max(dist - outerRadius * scale, innerRadius * scale - dist);
+}
+
+void main()
+{
+    vec4 fill = vColor;
+    float d;
+
+    if (vShape == SHAPE_CIRCLE) {
+        d = length(vLocal) - vHalfSize.x;
+    } else if (vShape == SHAPE_ELLIPSE) {
+        d = ellipse(vLocal, vHalfSize);
+    } else if (vShape == SHAPE_RECT) {
+        d = box(vLocal, vHalfSize);
+    } else if (vShape == SHAPE_RECT_GRADIENT) {
+        d = box(vLocal, vHalfSize);
+        vec2 t = clamp(vLocal / (2.0 * vHalfSize) + 0.5, 0.0, 1.0);
+        fill = mix(vColor, vSecondaryColor, vParams.x > 0.5 ? t.x : t.y);
+    } else if (vShape == SHAPE_ROUNDED_RECT) {
+        d = roundedBox(vLocal, vHalfSize, vParams.x);
+    } else {
+        d = ring(vLocal, vHalfSize.x);
+    }
+
+    float coverage = clamp(0.5 - d, 0.0, 1.0);
+    if (coverage <= 0.0) discard;
+
+    color = vec4(fill.rgb, fill.a * coverage);
+}
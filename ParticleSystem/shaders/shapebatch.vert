@@ -0,0 +1,38 @@
+#version 330 core
+
+layout (location = 0) in vec2 aCenter;
+layout (location = 1) in vec2 aHalfSize;
+layout (location = 2) in float aRotation;
+layout (location = 3) in float aShape;
+layout (location = 4) in vec4 aParams;
+layout (location = 5) in vec4 aColor;
+layout (location = 6) in vec4 aSecondaryColor;
+
+out vec2 vLocal;
+out vec2 vHalfSize;
+flat out int vShape;
+out vec4 vParams;
+out vec4 vColor;
+out vec4 vSecondaryColor;
+
+uniform mat4 uMVP;
+
+// Room for the anti aliased edge
+const float margin = 1.0;
+
+void main() {
+    // Triangle strip corners from the vertex id: (-1,-1), (1,-1), (-1,1), (1,1)
+    vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1)) * 2.0 - 1.0;
+
+    vLocal = corner * (aHalfSize + margin);
+    vHalfSize = aHalfSize;
+    vShape = int(aShape + 0.5);
+    vParams = aParams;
+    vColor = aColor;
+    vSecondaryColor = aSecondaryColor;
+
+    float c = cos(aRotation);
+    float s = sin(aRotation);
+    vec2 world = aCenter + vec2(vLocal.x * c - vLocal.y * s, vLocal.x * s + vLocal.y * c);
+    gl_Position = uMVP * vec4(world, 0.0, 1.0);
+}
@@ -1,16 +1,19 @@
 #pragma once
 
+#include <cstring>
+
 #include "common.hpp"
+#include "shapeinstances.hpp"
+#include "streamingbuffer.hpp"
 
+// Points are written straight into a StreamingBuffer region, each draw
+// call consumes one region so uploads never wait on the previous draw.
 class PointBatchRenderer
 {
-	struct Point
-	{
-		Vector2 position;
-		float size;
-		Color color;
-	};
+public:
+	using Point = PointInstance;
 
+private:
 	uint32_t vbo, vao, shader, projectionShaderLoc;
 
 	Matrix projection;
@@ -18,22 +21,27 @@ class PointBatchRenderer
 	uint32_t maxCapacity;
 	uint32_t count;
 
-	std::vector<Point> points;
+	Scoped<StreamingBuffer> stream;
+	Point* points;
 
 public:
-	PointBatchRenderer(uint32_t maxCapacity) :
+	PointBatchRenderer(uint32_t maxCapacity, StreamingBuffer::Mode mode = StreamingBuffer::DefaultMode()) :
 		maxCapacity(maxCapacity),
 		count(0),
 		vao(0),
 		vbo(0), 
 		shader(rlLoadShaderCode(LoadFileText("shaders/pointbatch.vert"), LoadFileText("shaders/pointbatch.frag"))),
 		projectionShaderLoc(rlGetLocationUniform(shader, "uProjection")),
-		projection()
+		projection(),
+		stream(nullptr),
+		points(nullptr)
 	{
 		vao = rlLoadVertexArray();
 		rlEnableVertexArray(vao);
 
-		vbo = rlLoadVertexBuffer(nullptr, maxCapacity * sizeof(Point), true);
+		// Storage is allocated by the streaming buffer
+		vbo = rlLoadVertexBuffer(nullptr, 0, true);
+		stream = MakeScoped<StreamingBuffer>(vbo, maxCapacity * sizeof(Point), 3, mode);
 
 		rlEnableVertexAttribute(0);
 		rlEnableVertexAttribute(1);
@@ -46,10 +54,10 @@ public:
 		rlDisableVertexArray();
 
 		glEnable(GL_PROGRAM_POINT_SIZE);
-
-		points.reserve(maxCapacity);
 	}
 
+	StreamingBuffer::Mode GetStreamingMode() const { return stream->GetMode(); }
+
 	void SetProjectionMatrix(const Matrix projection)
 	{
 		this->projection = projection;
@@ -57,37 +65,152 @@ public:
 
 	void Add(const Vector2 position, const float size, const Color color)
 	{
-		if (count + 1 > maxCapacity)
+		Reserve(1) [0] = { position, size, color };
+	}
+
+	// Hands out up to count consecutive points for the caller to fill, possibly from
+	// several threads. Fewer are returned when the current batch runs out of room,
+	// the full batch is drawn on the next reservation.
+	Span<Point> Reserve(uint32_t count)
+	{
+		if (points && this->count == maxCapacity)
 		{
 			Draw();
 		}
 
-		points.push_back({position, size, color});
-		count++;
+		if (!points)
+		{
+			points = (Point*)stream->Begin();
+		}
+
+		const auto reserved = std::min(count, maxCapacity - this->count);
+		Span<Point> span = { points + this->count, reserved };
+		this->count += reserved;
+		return span;
 	}
 
 	void Draw()
 	{
+		if (!points) return;
+
+		stream->End(count * sizeof(Point));
+
 		rlEnableShader(shader);
 		rlEnableVertexArray(vao);
 		rlEnableVertexBuffer(vbo);
 		rlSetUniformMatrix(projectionShaderLoc, projection);
-		rlUpdateVertexBuffer(vbo, points.data(), count * sizeof(Point), 0);
-		
-		glDrawArrays(GL_POINTS, 0, count);
+
+		// Attributes point at the start of the buffer, so the region is selected by the first vertex
+		glDrawArrays(GL_POINTS, stream->Region() * maxCapacity, count);
 
 		rlDisableVertexBuffer();
 		rlDisableVertexArray();
 		rlDisableShader();
 
-		points.clear();
+		stream->Advance();
+		points = nullptr;
 		count = 0;
 	}
 
 	~PointBatchRenderer()
 	{
+		stream.reset();
+		rlUnloadShaderProgram(shader);
+		rlUnloadVertexBuffer(vbo);
+		rlUnloadVertexArray(vao);
+	}
+};
+
+// Draws every ShapeInstance as an instanced quad, the shape itself is evaluated
+// as a signed distance field in the fragment shader. A whole instance buffer is
+// drawn in one call per maxCapacity instances, whatever shapes it mixes. Like the
+// points, every call uploads into its own StreamingBuffer region.
+class ShapeBatchRenderer
+{
+	uint32_t vbo, vao, shader, mvpShaderLoc;
+
+	uint32_t maxCapacity;
+
+	Scoped<StreamingBuffer> stream;
+
+public:
+	ShapeBatchRenderer(uint32_t maxCapacity, StreamingBuffer::Mode mode = StreamingBuffer::DefaultMode()) :
+		maxCapacity(maxCapacity),
+		vao(0),
+		vbo(0),
+		shader(rlLoadShaderCode(LoadFileText("shaders/shapebatch.vert"), LoadFileText("shaders/shapebatch.frag"))),
+		mvpShaderLoc(rlGetLocationUniform(shader, "uMVP")),
+		stream(nullptr)
+	{
+		vao = rlLoadVertexArray();
+		rlEnableVertexArray(vao);
+
+		// Storage is allocated by the streaming buffer
+		vbo = rlLoadVertexBuffer(nullptr, 0, true);
+		stream = MakeScoped<StreamingBuffer>(vbo, maxCapacity * sizeof(ShapeInstance), 3, mode);
+
+		for (uint32_t i = 0; i < 7; i++)
+		{
+			rlEnableVertexAttribute(i);
+			glVertexAttribDivisor(i, 1);
+		}
+		SetAttributes(0);
+
+		rlDisableVertexArray();
+	}
+
+	StreamingBuffer::Mode GetStreamingMode() const { return stream->GetMode(); }
+
+	void Draw(const ShapeInstanceBuffer& instances)
+	{
+		if (instances.IsEmpty()) return;
+
+		// Flush raylib's own batch first so draw order is kept
+		rlDrawRenderBatchActive();
+
+		rlEnableShader(shader);
+		rlEnableVertexArray(vao);
+		rlSetUniformMatrix(mvpShaderLoc, MatrixMultiply(rlGetMatrixModelview(), rlGetMatrixProjection()));
+
+		for (std::size_t first = 0; first < instances.Size(); first += maxCapacity)
+		{
+			const auto count = (uint32_t)std::min<std::size_t>(maxCapacity, instances.Size() - first);
+			const auto size = count * sizeof(ShapeInstance);
+
+			std::memcpy(stream->Begin(), instances.Data() + first, size);
+			stream->End(size);
+
+			// Instanced draws have no base instance before GL 4.2, so the attributes are pointed at the region
+			rlEnableVertexBuffer(vbo);
+			SetAttributes(stream->Offset());
+			glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+
+			stream->Advance();
+		}
+
+		rlDisableVertexBuffer();
+		rlDisableVertexArray();
+		rlDisableShader();
+	}
+
+	~ShapeBatchRenderer()
+	{
+		stream.reset();
 		rlUnloadShaderProgram(shader);
 		rlUnloadVertexBuffer(vbo);
 		rlUnloadVertexArray(vao);
 	}
+
+private:
+	// Quad corners come from gl_VertexID, every attribute is per instance. The vao and vbo must be bound.
+	static void SetAttributes(std::size_t offset)
+	{
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(ShapeInstance), (GLvoid*)(offset + offsetof(ShapeInstance, center)));
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(ShapeInstance), (GLvoid*)(offset + offsetof(ShapeInstance, halfSize)));
+		glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(ShapeInstance), (GLvoid*)(offset + offsetof(ShapeInstance, rotation)));
+		glVertexAttribPointer(3, 1, GL_UNSIGNED_INT, GL_FALSE, sizeof(ShapeInstance), (GLvoid*)(offset + offsetof(ShapeInstance, shape)));
+		glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(ShapeInstance), (GLvoid*)(offset + offsetof(ShapeInstance, params)));
+		glVertexAttribPointer(5, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ShapeInstance), (GLvoid*)(offset + offsetof(ShapeInstance, color)));
+		glVertexAttribPointer(6, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ShapeInstance), (GLvoid*)(offset + offsetof(ShapeInstance, secondaryColor)));
+	}
 };
\ No newline at end of file
@@ -0,0 +1,764 @@
+#include "common.hpp"
+#include "instrumentation.hpp"
+
+#include "particles/naive.hpp"
+#include "particles/simple.hpp"
+#include "particles/advanced.hpp"
+#include "particles/ecs.hpp"
+#include "softwarerenderbackend.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+
+// Headless simulation benchmark. Drives the update loop of every particle engine
+// with a fixed timestep and reports the results as JSON. Nothing in here opens a
+// window or touches GL, so it runs on machines without a display or GPU. With
+// --render the engines also draw every frame through the software render backend.
+// With --storage-sizes the ECS hot component sets are also iterated through views
+// and through the particle groups, at each of the given entity counts.
+
+// Heap Accounting //
+// Every allocation is prefixed with its size so peak memory can be tracked per
+// engine without relying on platform specific process statistics.
+
+namespace heap
+{
+	constexpr std::size_t HeaderSize = alignof(std::max_align_t);
+
+	std::atomic<std::size_t> current = 0;
+	std::atomic<std::size_t> peak = 0;
+
+	void* Allocate(std::size_t size)
+	{
+		auto block = static_cast<char*>(std::malloc(size + HeaderSize));
+		if (!block) return nullptr;
+
+		*reinterpret_cast<std::size_t*>(block) = size;
+
+		const auto now = current.fetch_add(size) + size;
+		auto previous = peak.load();
+		while (now > previous && !peak.compare_exchange_weak(previous, now));
+
+		return block + HeaderSize;
+	}
+
+	void Free(void* ptr)
+	{
+		if (!ptr) return;
+
+		auto block = static_cast<char*>(ptr) - HeaderSize;
+		current.fetch_sub(*reinterpret_cast<std::size_t*>(block));
+		std::free(block);
+	}
+
+	void ResetPeak() { peak = current.load(); }
+}
+
+void* operator new(std::size_t size)
+{
+	if (auto ptr = heap::Allocate(size)) return ptr;
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) { return operator new(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return heap::Allocate(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return heap::Allocate(size); }
+void operator delete(void* ptr) noexcept { heap::Free(ptr); }
+void operator delete[](void* ptr) noexcept { heap::Free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { heap::Free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { heap::Free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { heap::Free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { heap::Free(ptr); }
+
+namespace benchmark
+{
+	using Clock = std::chrono::steady_clock;
+	using Nanoseconds = std::chrono::duration<double, std::nano>;
+
+	struct Settings
+	{
+		uint32_t frames = 600;
+		float dt = 1.0f / 60.0f;
+		uint32_t spawnCount = 25000;
+		float spawnRate = 0.1f;
+		float lifeTime = 2.0f;
+		uint64_t seed = 1;
+		std::string engines = "naive,simple,advanced,ecs";
+		std::string output;
+
+		// Rendering is off while the size is 0
+		int renderWidth = 0;
+		int renderHeight = 0;
+		std::string dumpDirectory;
+		std::string goldenDirectory;
+		int goldenTolerance = 2;
+		bool isPipelined = false;
+
+		// Entity counts of the views against groups comparison, skipped when empty
+		std::vector<std::size_t> storageSizes;
+		uint32_t storageRepeats = 10;
+
+		bool IsRendering() const { return renderWidth > 0 && renderHeight > 0; }
+
+		// Emitters sit in the middle of the framebuffer
+		Vector2 Center() const { return { renderWidth * 0.5f, renderHeight * 0.5f }; }
+	};
+
+	class IEngine
+	{
+	public:
+		virtual const char* GetName() = 0;
+		virtual void Start(const Settings& settings) = 0;
+		virtual void Spawn(uint32_t count, float time) = 0;
+		virtual void Update(float time, float dt) = 0;
+		virtual std::size_t ParticleCount() = 0;
+		virtual ~IEngine() = default;
+
+		// Engines drawing through the render backend
+		virtual bool CanDraw() { return false; }
+		virtual void Draw() {}
+		virtual void SetPipelined(bool) {}
+	};
+
+	class NaiveEngine : public IEngine
+	{
+		Scoped<naive::ParticleSystem> particleSystem;
+
+	public:
+		const char* GetName() override { return "naive"; }
+
+		void Start(const Settings& settings) override
+		{
+			naive::Particle protoParticle;
+			protoParticle.acceleration.y = 100.0f;
+			protoParticle.lifeTime = settings.lifeTime;
+			protoParticle.hasColorOverLifetime = true;
+			protoParticle.colorOverLifetime = naive::Gradient({
+					{ 0.0f, ColorAlpha(YELLOW, 0.f)},
+					{0.5f, ColorAlpha(SKYBLUE, 0.25f)},
+					{1.0f, ColorAlpha(RED, 0.f)}
+				});
+			protoParticle.hasSizeOverLifetime = true;
+			protoParticle.sizeOverLifetime = Vector2{ 0, 10 };
+
+			particleSystem = MakeScoped<naive::ParticleSystem>(protoParticle, settings.Center(), settings.spawnRate, settings.spawnCount);
+		}
+
+		void Spawn(uint32_t count, float time) override { particleSystem->Spawn(count, time); }
+		void Update(float time, float dt) override { particleSystem->Update(time, dt); }
+		std::size_t ParticleCount() override { return particleSystem->ParticleCount(); }
+	};
+
+	class SimpleEngine : public IEngine
+	{
+		Scoped<simple::ParticleEmitter> emitter;
+
+	public:
+		~SimpleEngine()
+		{
+			emitter.reset();
+			simple::manager.reset();
+		}
+
+		const char* GetName() override { return "simple"; }
+
+		void Start(const Settings& settings) override
+		{
+			simple::manager = MakeScoped<simple::ParticleManager>();
+
+			auto sharedData = MakeRef<simple::SharedParticleData>();
+			sharedData->lifeTime = settings.lifeTime;
+			sharedData->sizeOverLifetime = MakeRef<Curve<float>>(Curve<float>{ { 0.0f, 0.0f }, { 1.0f, 20.0f } });
+			sharedData->colorOverLifetime = MakeRef<naive::Gradient>(naive::Gradient({
+					{ 0.0f, ColorAlpha(PURPLE, 0.f)},
+					{0.5f, ColorAlpha(SKYBLUE, 0.5f)},
+					{1.0f, ColorAlpha(DARKBLUE, 0.f)}
+				}));
+
+			emitter = MakeScoped<simple::ParticleEmitter>(MakeRef<BoxEmitterShape>(100.0f, 100.0f), sharedData, settings.Center(), 45.0f, settings.spawnRate, settings.spawnCount);
+			emitter->Start();
+		}
+
+		void Spawn(uint32_t count, float time) override { emitter->Spawn(count, time); }
+		void Update(float time, float dt) override { simple::manager->Update(time, dt); }
+		std::size_t ParticleCount() override { return simple::manager->ParticleCount(); }
+	};
+
+	class AdvancedEngine : public IEngine
+	{
+		Scoped<advanced::ParticleEmitter> emitter;
+
+	public:
+		~AdvancedEngine()
+		{
+			emitter.reset();
+			advanced::manager.reset();
+		}
+
+		const char* GetName() override { return "advanced"; }
+
+		void Start(const Settings& settings) override
+		{
+			advanced::manager = MakeScoped<advanced::ParticleManager>();
+
+			auto sharedData = MakeRef<advanced::SharedParticleData>();
+			sharedData->lifeTime = settings.lifeTime;
+			sharedData->drawer = MakeRef<PixelParticleDrawer>();
+			sharedData->colorOverLifetime = MakeRef<advanced::Gradient>(advanced::Gradient{
+					{ 0.0f, ColorAlpha(DARKGREEN, 0.f)},
+					{0.5f, ColorAlpha(GOLD, 1.0f)},
+					{1.0f, ColorAlpha(ORANGE, 0.f)}
+				});
+			sharedData->sizeOverLifetime = MakeRef<advanced::Vector2Interpolator>(advanced::Vector2Interpolator{
+					{0.f, {0.f, 0.f}},
+					{0.9f, {10.f, 0.f}},
+					{1.f, {10.f, 0.f}}
+				});
+
+			emitter = MakeScoped<advanced::ParticleEmitter>(MakeRef<BoxEmitterShape>(400.0f, 400.0f), sharedData, settings.Center(), 45.0f, settings.spawnRate, settings.spawnCount);
+			emitter->Start();
+		}
+
+		void Spawn(uint32_t count, float time) override { emitter->Spawn(count, time); }
+		void Update(float time, float dt) override { advanced::manager->Update(time, dt); }
+		std::size_t ParticleCount() override { return advanced::manager->ParticleCount(); }
+		bool CanDraw() override { return true; }
+		void Draw() override { advanced::manager->DrawParticles(); }
+		void SetPipelined(bool isPipelined) override { advanced::manager->SetPipelined(isPipelined); }
+	};
+
+	class ECSEngine : public IEngine
+	{
+		Ref<ecs::Entity> emitter;
+		ecs::SharedParticleData sharedData;
+		Vector2 center;
+
+	public:
+		~ECSEngine()
+		{
+			emitter.reset();
+			ecs::Destroy();
+		}
+
+		const char* GetName() override { return "ecs"; }
+
+		void Start(const Settings& settings) override
+		{
+			ecs::Init();
+			center = settings.Center();
+
+			sharedData.lifetime = settings.lifeTime;
+			sharedData.emitterShape = MakeRef<BoxEmitterShape>(600.0f, 600.0f, false);
+			sharedData.size = { 6.0f, 10.0f };
+			sharedData.acceleration = { 0.0f, 98.0f };
+			sharedData.colorOverLifetime = MakeRef<ecs::ColorOverLifetimeComponent>(ecs::ColorOverLifetimeComponent{
+				{0.0f, ColorAlpha(DARKBLUE, 0.f)},
+				{0.5f, ColorAlpha(SKYBLUE, 1.0f)},
+				{1.0f, ColorAlpha(GREEN, 0.f)}
+				});
+			sharedData.drawType = ecs::DrawType::POINT;
+
+			emitter = ecs::SpawnEmitter(sharedData, settings.spawnCount, center, 0.0f, settings.spawnRate, 0.0f);
+			emitter->GetComponent<ecs::EmitterComponent>().isSpawning = true;
+		}
+
+		void Spawn(uint32_t count, float time) override { ecs::manager->Spawn(sharedData, count, center, 0.0f, time); }
+		void Update(float time, float dt) override { ecs::Update(time, dt); }
+		std::size_t ParticleCount() override { return ecs::manager->ParticleCount(); }
+		bool CanDraw() override { return true; }
+		void Draw() override { ecs::manager->DrawParticles(); }
+		void SetPipelined(bool isPipelined) override { ecs::manager->SetPipelined(isPipelined); }
+	};
+
+	Scoped<IEngine> CreateEngine(const std::string& name)
+	{
+		if (name == "naive") return MakeScoped<NaiveEngine>();
+		if (name == "simple") return MakeScoped<SimpleEngine>();
+		if (name == "advanced") return MakeScoped<AdvancedEngine>();
+		if (name == "ecs") return MakeScoped<ECSEngine>();
+		return nullptr;
+	}
+
+	struct Result
+	{
+		std::string name;
+		uint32_t frames;
+		std::size_t peakParticles;
+		double meanParticles;
+		double updateNsPerParticle;
+		uint32_t spawnCount;
+		double spawnNs;
+		std::size_t peakHeapBytes;
+		double frameMean;
+		double frameP50;
+		double frameP90;
+		double frameP99;
+		double frameMax;
+		bool isDrawn;
+		bool isPipelined;
+		double drawNsPerParticle;
+		double drawMean;
+		double drawFrameMean;
+		int64_t goldenMismatches;
+	};
+
+	double Percentile(const std::vector<double>& sorted, double p)
+	{
+		if (sorted.empty()) return 0.0;
+		return sorted [(std::size_t)(p * (sorted.size() - 1) + 0.5)];
+	}
+
+	Result Run(IEngine& engine, const Settings& settings)
+	{
+		// Created up front so the framebuffer does not count towards the engine's heap
+		SoftwareRenderBackend* backend = nullptr;
+		if (settings.IsRendering() && engine.CanDraw())
+		{
+			auto software = MakeScoped<SoftwareRenderBackend>(settings.renderWidth, settings.renderHeight);
+			backend = software.get();
+			SetRenderBackend(std::move(software));
+		}
+
+		heap::ResetPeak();
+		const auto baseline = heap::current.load();
+
+		Result result = {};
+		result.name = engine.GetName();
+		result.frames = settings.frames;
+		result.spawnCount = settings.spawnCount;
+		result.isDrawn = backend != nullptr;
+		result.isPipelined = backend && settings.isPipelined;
+		result.goldenMismatches = -1;
+
+		// Every engine spawns from the same random sequence
+		SeedRandom(settings.seed);
+
+		engine.Start(settings);
+		if (result.isPipelined) engine.SetPipelined(true);
+
+		// Single burst to isolate spawn cost from the rest of the update
+		auto start = Clock::now();
+		engine.Spawn(settings.spawnCount, 0.0f);
+		result.spawnNs = Nanoseconds(Clock::now() - start).count();
+
+		std::vector<double> frameTimes;
+		frameTimes.reserve(settings.frames);
+
+		double updateNs = 0.0;
+		double drawNs = 0.0;
+		double particleFrames = 0.0;
+
+		for (uint32_t frame = 1; frame <= settings.frames; frame++)
+		{
+			const float time = frame * settings.dt;
+
+			start = Clock::now();
+			engine.Update(time, settings.dt);
+			const auto elapsed = Nanoseconds(Clock::now() - start).count();
+
+			// Pipelined engines return from Update right away, the draw waits for the simulation
+			if (backend)
+			{
+				backend->Clear(BLACK);
+
+				start = Clock::now();
+				engine.Draw();
+				drawNs += Nanoseconds(Clock::now() - start).count();
+			}
+
+			const auto particleCount = engine.ParticleCount();
+
+			frameTimes.push_back(elapsed);
+			updateNs += elapsed;
+			particleFrames += (double)particleCount;
+			result.peakParticles = std::max(result.peakParticles, particleCount);
+		}
+
+		result.peakHeapBytes = heap::peak.load() - baseline;
+		result.meanParticles = particleFrames / std::max(1u, settings.frames);
+		result.updateNsPerParticle = particleFrames > 0.0 ? updateNs / particleFrames : 0.0;
+
+		std::sort(frameTimes.begin(), frameTimes.end());
+		result.frameMean = updateNs / std::max<std::size_t>(1, frameTimes.size());
+		result.frameP50 = Percentile(frameTimes, 0.50);
+		result.frameP90 = Percentile(frameTimes, 0.90);
+		result.frameP99 = Percentile(frameTimes, 0.99);
+		result.frameMax = frameTimes.empty() ? 0.0 : frameTimes.back();
+
+		if (backend)
+		{
+			result.drawNsPerParticle = particleFrames > 0.0 ? drawNs / particleFrames : 0.0;
+			result.drawMean = drawNs / std::max(1u, settings.frames);
+			result.drawFrameMean = (updateNs + drawNs) / std::max(1u, settings.frames);
+
+			// The last frame is kept for inspection and golden image comparison
+			const auto fileName = result.name + ".png";
+			if (!settings.dumpDirectory.empty() && !backend->Export((settings.dumpDirectory + "/" + fileName).c_str()))
+			{
+				std::fprintf(stderr, "Failed to write %s\n", fileName.c_str());
+			}
+			if (!settings.goldenDirectory.empty())
+			{
+				result.goldenMismatches = backend->Compare((settings.goldenDirectory + "/" + fileName).c_str(), settings.goldenTolerance);
+			}
+
+			SetRenderBackend(nullptr);
+		}
+
+		return result;
+	}
+
+	// Views against Groups //
+	// The same per particle work over the ECS hot component sets: once through views,
+	// which look every component up through its sparse set, and once through the
+	// particle groups, which walk the packed storages by index.
+
+	struct StorageTimes
+	{
+		double motionMs;
+		double lifetimeMs;
+		double renderMs;
+	};
+
+	struct StorageResult
+	{
+		std::size_t entities;
+		bool isPacked;
+		StorageTimes views;
+		StorageTimes groups;
+	};
+
+	// Time the storage passes run at, every populated particle is alive then
+	constexpr float ParticleTime = 2.0f;
+
+	// Particles as ecs::ParticleManager spawns them, all sharing one prototype
+	void PopulateParticles(ecs::ps_registry& reg, std::size_t count)
+	{
+		std::vector<ecs::ps_entity> entities(count);
+		reg.create(entities.begin(), entities.end());
+
+		std::vector<ecs::LifetimeComponent> lifetimes(count);
+		std::vector<ecs::PositionComponent> positions(count);
+		std::vector<ecs::VelocityComponent> velocities(count);
+		std::vector<ecs::AccelerationComponent> accelerations(count);
+		std::vector<ecs::SizeComponent> sizes(count);
+		std::vector<ecs::ColorComponent> colors(count);
+
+		for (std::size_t i = 0; i < count; i++)
+		{
+			lifetimes [i] = { 2.0f, Random(0.0f, 2.0f) };
+			positions [i] = { { Random(0.0f, 1280.0f), Random(0.0f, 720.0f) } };
+			velocities [i] = { { Random(-100.0f, 100.0f), Random(-100.0f, 100.0f) } };
+			accelerations [i] = { { 0.0f, 98.0f } };
+			sizes [i] = { { 1.0f, 1.0f } };
+			colors [i] = { WHITE };
+		}
+
+		reg.insert<ecs::LifetimeComponent>(entities.begin(), entities.end(), lifetimes.begin());
+		reg.insert<ecs::PositionComponent>(entities.begin(), entities.end(), positions.begin());
+		reg.insert<ecs::VelocityComponent>(entities.begin(), entities.end(), velocities.begin());
+		reg.insert<ecs::AccelerationComponent>(entities.begin(), entities.end(), accelerations.begin());
+		reg.insert<ecs::SizeComponent>(entities.begin(), entities.end(), sizes.begin());
+		reg.insert<ecs::ColorComponent>(entities.begin(), entities.end(), colors.begin());
+		reg.insert<ecs::ColorOverLifetimeComponent>(entities.begin(), entities.end(), ecs::ColorOverLifetimeComponent{ { 0.0f, WHITE }, { 1.0f, BLANK } });
+		reg.insert<ecs::PointBatchDrawComponent>(entities.begin(), entities.end());
+	}
+
+	// Mean milliseconds of one call over the repeats
+	template<typename Function>
+	double TimeMs(uint32_t repeats, Function function)
+	{
+		const auto start = Clock::now();
+		for (uint32_t i = 0; i < repeats; i++) function();
+		return Nanoseconds(Clock::now() - start).count() * 1e-6 / std::max(1u, repeats);
+	}
+
+	StorageTimes RunViews(std::size_t count, const Settings& settings, std::vector<PointInstance>& points)
+	{
+		ecs::ps_registry reg;
+		PopulateParticles(reg, count);
+
+		const float dt = settings.dt;
+		StorageTimes times = {};
+
+		times.motionMs = TimeMs(settings.storageRepeats, [&reg, dt]
+			{
+				auto view = reg.view<ecs::PositionComponent, ecs::VelocityComponent, const ecs::AccelerationComponent>();
+				for (const auto entity : view)
+				{
+					auto [position, velocity, acceleration] = view.get<ecs::PositionComponent, ecs::VelocityComponent, const ecs::AccelerationComponent>(entity);
+					velocity.velocity = Vector2Add(velocity.velocity, Vector2Scale(acceleration.acceleration, dt));
+					position.position = Vector2Add(position.position, Vector2Scale(velocity.velocity, dt));
+				}
+			});
+
+		times.lifetimeMs = TimeMs(settings.storageRepeats, [&reg]
+			{
+				auto view = reg.view<ecs::ColorOverLifetimeComponent, const ecs::LifetimeComponent>();
+				for (const auto entity : view)
+				{
+					auto [colorOverLifetime, lifetime] = view.get<ecs::ColorOverLifetimeComponent, const ecs::LifetimeComponent>(entity);
+					ecs::Interpolate(colorOverLifetime, lifetime, ParticleTime);
+				}
+			});
+
+		times.renderMs = TimeMs(settings.storageRepeats, [&reg, &points]
+			{
+				auto view = reg.view<const ecs::PositionComponent, const ecs::VelocityComponent, const ecs::ColorComponent, const ecs::SizeComponent, const ecs::PointBatchDrawComponent>();
+				std::size_t i = 0;
+				for (const auto entity : view)
+				{
+					auto [position, velocity, color, size] = view.get<const ecs::PositionComponent, const ecs::VelocityComponent, const ecs::ColorComponent, const ecs::SizeComponent>(entity);
+					points [i++] = { ecs::RenderPosition(position, velocity, 0.0f), size.size.x, color.color };
+				}
+			});
+
+		return times;
+	}
+
+	StorageTimes RunGroups(std::size_t count, const Settings& settings, std::vector<PointInstance>& points, bool& isPacked)
+	{
+		ecs::ps_registry reg;
+		ecs::ParticleGroup(reg);
+		ecs::AcceleratedParticleGroup(reg);
+
+		ecs::GroupFollowers followers;
+		followers.Add<ecs::ColorOverLifetimeComponent>();
+		followers.Add<ecs::PointBatchDrawComponent>();
+
+		PopulateParticles(reg, count);
+		followers.Update(reg);
+
+		isPacked = followers.Follows<ecs::ColorOverLifetimeComponent>() && followers.Follows<ecs::PointBatchDrawComponent>();
+
+		const float dt = settings.dt;
+		StorageTimes times = {};
+
+		times.motionMs = TimeMs(settings.storageRepeats, [&reg, dt]
+			{
+				ecs::EachPackedParticle<ecs::PositionComponent, ecs::VelocityComponent, const ecs::AccelerationComponent>(reg,
+					[dt](ecs::PositionComponent& position, ecs::VelocityComponent& velocity, const ecs::AccelerationComponent& acceleration)
+					{
+						velocity.velocity = Vector2Add(velocity.velocity, Vector2Scale(acceleration.acceleration, dt));
+						position.position = Vector2Add(position.position, Vector2Scale(velocity.velocity, dt));
+					});
+			});
+
+		// The systems check the storages every frame, so the checks are timed too
+		times.lifetimeMs = TimeMs(settings.storageRepeats, [&reg, &followers]
+			{
+				if (!followers.Follows<ecs::ColorOverLifetimeComponent>()) return;
+
+				ecs::EachPackedParticle<ecs::ColorOverLifetimeComponent, const ecs::LifetimeComponent>(reg,
+					[](ecs::ColorOverLifetimeComponent& colorOverLifetime, const ecs::LifetimeComponent& lifetime)
+					{
+						ecs::Interpolate(colorOverLifetime, lifetime, ParticleTime);
+					});
+			});
+
+		times.renderMs = TimeMs(settings.storageRepeats, [&reg, &points, &followers]
+			{
+				if (!followers.Follows<ecs::PointBatchDrawComponent>()) return;
+
+				std::size_t i = 0;
+				ecs::EachPackedParticle<const ecs::PositionComponent, const ecs::VelocityComponent, const ecs::ColorComponent, const ecs::SizeComponent>(reg,
+					[&points, &i](const ecs::PositionComponent& position, const ecs::VelocityComponent& velocity, const ecs::ColorComponent& color, const ecs::SizeComponent& size)
+					{
+						points [i++] = { ecs::RenderPosition(position, velocity, 0.0f), size.size.x, color.color };
+					});
+			});
+
+		return times;
+	}
+
+	// Single threaded, so the difference is the memory access pattern alone
+	StorageResult RunStorage(std::size_t count, const Settings& settings)
+	{
+		StorageResult result = {};
+		result.entities = count;
+
+		std::vector<PointInstance> points(count);
+
+		SeedRandom(settings.seed);
+		result.views = RunViews(count, settings, points);
+
+		SeedRandom(settings.seed);
+		result.groups = RunGroups(count, settings, points, result.isPacked);
+
+		return result;
+	}
+
+	void WriteJson(std::ostream& out, const Settings& settings, const std::vector<Result>& results, const std::vector<StorageResult>& storageResults)
+	{
+		constexpr double NsToMs = 1e-6;
+
+		out << std::fixed << std::setprecision(3);
+		out << "{\n";
+		out << "  \"settings\": {";
+		out << "\"frames\": " << settings.frames << ", ";
+		out << "\"dt\": " << std::setprecision(6) << settings.dt << std::setprecision(3) << ", ";
+		out << "\"spawnCount\": " << settings.spawnCount << ", ";
+		out << "\"spawnRate\": " << settings.spawnRate << ", ";
+		out << "\"lifeTime\": " << settings.lifeTime << ", ";
+		out << "\"seed\": " << settings.seed << ", ";
+		if (settings.IsRendering()) out << "\"render\": \"" << settings.renderWidth << "x" << settings.renderHeight << "\", ";
+		out << "\"instructionSet\": \"" << kinematics::Stringify(kinematics::GetInstructionSet()) << "\"},\n";
+		out << "  \"engines\": [";
+
+		for (std::size_t i = 0; i < results.size(); i++)
+		{
+			const auto& result = results [i];
+
+			out << (i == 0 ? "\n" : ",\n");
+			out << "    {";
+			out << "\"name\": \"" << result.name << "\", ";
+			out << "\"frames\": " << result.frames << ", ";
+			out << "\"peakParticles\": " << result.peakParticles << ", ";
+			out << "\"meanParticles\": " << result.meanParticles << ", ";
+			out << "\"updateNsPerParticle\": " << result.updateNsPerParticle << ", ";
+			out << "\"spawn\": {\"count\": " << result.spawnCount << ", \"totalMs\": " << result.spawnNs * NsToMs
+				<< ", \"nsPerParticle\": " << (result.spawnCount ? result.spawnNs / result.spawnCount : 0.0) << "}, ";
+			out << "\"peakHeapBytes\": " << result.peakHeapBytes << ", ";
+			out << "\"frameTimeMs\": {";
+			out << "\"mean\": " << result.frameMean * NsToMs << ", ";
+			out << "\"p50\": " << result.frameP50 * NsToMs << ", ";
+			out << "\"p90\": " << result.frameP90 * NsToMs << ", ";
+			out << "\"p99\": " << result.frameP99 * NsToMs << ", ";
+			out << "\"max\": " << result.frameMax * NsToMs << "}";
+			if (result.isDrawn)
+			{
+				out << ", \"draw\": {";
+				out << "\"backend\": \"software\", ";
+				out << "\"pipelined\": " << (result.isPipelined ? "true" : "false") << ", ";
+				out << "\"nsPerParticle\": " << result.drawNsPerParticle << ", ";
+				out << "\"meanMs\": " << result.drawMean * NsToMs << ", ";
+				out << "\"frameMeanMs\": " << result.drawFrameMean * NsToMs;
+				if (!settings.goldenDirectory.empty()) out << ", \"goldenMismatches\": " << result.goldenMismatches;
+				out << "}";
+			}
+			out << "}";
+		}
+
+		out << "\n  ]";
+
+		if (!storageResults.empty())
+		{
+			const auto writeTimes = [&out](const StorageTimes& times)
+			{
+				out << "{\"motion\": " << times.motionMs << ", \"lifetime\": " << times.lifetimeMs << ", \"render\": " << times.renderMs << "}";
+			};
+
+			out << ",\n  \"storage\": {\"repeats\": " << settings.storageRepeats << ", \"results\": [";
+			for (std::size_t i = 0; i < storageResults.size(); i++)
+			{
+				const auto& result = storageResults [i];
+
+				out << (i == 0 ? "\n" : ",\n");
+				out << "    {";
+				out << "\"entities\": " << result.entities << ", ";
+				out << "\"packed\": " << (result.isPacked ? "true" : "false") << ", ";
+				out << "\"viewsMs\": ";
+				writeTimes(result.views);
+				out << ", \"groupsMs\": ";
+				writeTimes(result.groups);
+				out << "}";
+			}
+			out << "\n  ]}";
+		}
+
+		out << "\n}\n";
+	}
+
+	bool ParseArguments(int argc, char** argv, Settings& settings)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			const char* arg = argv [i];
+			const char* value = i + 1 < argc ? argv [i + 1] : nullptr;
+
+			if (std::strcmp(arg, "--help") == 0 || !value) return false;
+
+			if (std::strcmp(arg, "--frames") == 0) settings.frames = (uint32_t)std::strtoul(value, nullptr, 10);
+			else if (std::strcmp(arg, "--dt") == 0) settings.dt = std::strtof(value, nullptr);
+			else if (std::strcmp(arg, "--spawn-count") == 0) settings.spawnCount = (uint32_t)std::strtoul(value, nullptr, 10);
+			else if (std::strcmp(arg, "--spawn-rate") == 0) settings.spawnRate = std::strtof(value, nullptr);
+			else if (std::strcmp(arg, "--lifetime") == 0) settings.lifeTime = std::strtof(value, nullptr);
+			else if (std::strcmp(arg, "--seed") == 0) settings.seed = std::strtoull(value, nullptr, 10);
+			else if (std::strcmp(arg, "--engines") == 0) settings.engines = value;
+			else if (std::strcmp(arg, "--output") == 0) settings.output = value;
+			else if (std::strcmp(arg, "--render") == 0)
+			{
+				if (std::sscanf(value, "%dx%d", &settings.renderWidth, &settings.renderHeight) != 2) return false;
+			}
+			else if (std::strcmp(arg, "--dump-dir") == 0) settings.dumpDirectory = value;
+			else if (std::strcmp(arg, "--golden-dir") == 0) settings.goldenDirectory = value;
+			else if (std::strcmp(arg, "--golden-tolerance") == 0) settings.goldenTolerance = (int)std::strtol(value, nullptr, 10);
+			else if (std::strcmp(arg, "--pipelined") == 0) settings.isPipelined = std::strtol(value, nullptr, 10) != 0;
+			else if (std::strcmp(arg, "--storage-sizes") == 0)
+			{
+				std::stringstream sizes(value);
+				std::string size;
+				while (std::getline(sizes, size, ',')) settings.storageSizes.push_back(std::strtoull(size.c_str(), nullptr, 10));
+			}
+			else if (std::strcmp(arg, "--storage-repeats") == 0) settings.storageRepeats = (uint32_t)std::strtoul(value, nullptr, 10);
+			else return false;
+
+			i++;
+		}
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	benchmark::Settings settings;
+	if (!benchmark::ParseArguments(argc, argv, settings))
+	{
+		std::fprintf(stderr, "Usage: %s [--frames N] [--dt SECONDS] [--spawn-count N] [--spawn-rate SECONDS] "
+					 "[--lifetime SECONDS] [--seed N] [--engines naive,simple,advanced,ecs] [--output FILE] "
+					 "[--render WIDTHxHEIGHT] [--dump-dir DIR] [--golden-dir DIR] [--golden-tolerance N] [--pipelined 0|1] "
+					 "[--storage-sizes 100000,1000000,5000000] [--storage-repeats N]\n", argv [0]);
+		return 1;
+	}
+
+	std::vector<benchmark::Result> results;
+
+	std::stringstream engines(settings.engines);
+	std::string name;
+	while (std::getline(engines, name, ','))
+	{
+		auto engine = benchmark::CreateEngine(name);
+		if (!engine)
+		{
+			std::fprintf(stderr, "Unknown engine '%s'\n", name.c_str());
+			return 1;
+		}
+
+		std::fprintf(stderr, "Running %s...\n", name.c_str());
+		results.push_back(benchmark::Run(*engine, settings));
+	}
+
+	std::vector<benchmark::StorageResult> storageResults;
+	for (const auto size : settings.storageSizes)
+	{
+		std::fprintf(stderr, "Running views against groups at %zu entities...\n", size);
+		storageResults.push_back(benchmark::RunStorage(size, settings));
+	}
+
+	if (settings.output.empty())
+	{
+		benchmark::WriteJson(std::cout, settings, results, storageResults);
+	}
+	else
+	{
+		std::ofstream file(settings.output);
+		benchmark::WriteJson(file, settings, results, storageResults);
+	}
+
+	return 0;
+}
@@ -8,6 +8,7 @@
 #include <set>
 #include <limits>
 #include <algorithm>
+#include <numeric>
 #include <cstdlib>
 #include <cstdarg>
 #include <ctime>
@@ -24,6 +25,8 @@
 
 #include <glad/glad.h>
 
+#include "random.hpp"
+
 #define ENTT_USE_ATOMIC
 #include <entt/entt.hpp>
 
@@ -56,6 +59,19 @@ constexpr Scoped<T> MakeScoped(Args&& ... args)
 	return std::make_unique<T>(std::forward<Args>(args)...);
 }
 
+// Non owning view over contiguous elements, stands in for std::span until C++20
+template<typename T>
+struct Span
+{
+	T* data;
+	std::size_t size;
+
+	T* begin() const { return data; }
+	T* end() const { return data + size; }
+	T& operator[](std::size_t index) const { return data [index]; }
+	bool IsEmpty() const { return size == 0; }
+};
+
 // Generates Temporary IDs of derived type
 template<typename T>
 class TUID
@@ -74,38 +90,6 @@ float Clamp01(float value)
 	return Clamp(value, 0.f, 1.f);
 }
 
-std::random_device rd;
-std::mt19937 gen(rd());
-std::uniform_real_distribution<float> dis(0.0f, 1.0f);
-
-float Random()
-{
-	return dis(gen);
-}
-
-float Random(float min, float max)
-{
-	return Remap(Random(), 0.0f, 1.0f, min, max);
-}
-
-float RandomSpread(float spread)
-{
-	return Random(-spread, spread);
-}
-
-Vector2 RandomVector2(float min, float max)
-{
-	return Vector2 { Random(Random(min, max), Random(min, max)), Random(Random(min, max), Random(min, max)) };
-}
-
-Vector2 RandomVector2(Vector2 index1, Vector2 index2)
-{
-	return Vector2 {
-	Random(Random(index1.x, index1.y), Random(index1.x, index1.y)),
-	Random(Random(index2.x, index2.y), Random(index2.x, index2.y))
-	};
-}
-
 constexpr Vector2 Up = Vector2 { 0.0, 1.0 };
 constexpr Vector2 Right = Vector2 { 1.0, 0.0 };
 constexpr Vector2 Down = Vector2 { 0.0, -1.0 };
@@ -168,4 +152,14 @@ class IRandomize
 {
 public:
 	virtual void Randomize() = 0;
+};
+
+// Scenes able to simulate the next frame while the current one is drawn
+class IPipelined
+{
+public:
+	virtual void SetPipelined(bool isPipelined) = 0;
+	virtual bool IsPipelined() = 0;
+	// Waits for the frame being simulated, the scene's state belongs to the main thread afterwards
+	virtual void Sync() = 0;
 };
\ No newline at end of file
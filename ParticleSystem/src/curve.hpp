@@ -0,0 +1,158 @@
+#pragma once
+
+#include <mutex>
+
+#include "common.hpp"
+
+float LerpValue(float value1, float value2, float t) { return Lerp(value1, value2, t); }
+Vector2 LerpValue(Vector2 value1, Vector2 value2, float t) { return Vector2Lerp(value1, value2, t); }
+
+bool IsSameValue(float value1, float value2) { return value1 == value2; }
+bool IsSameValue(Vector2 value1, Vector2 value2) { return value1.x == value2.x && value1.y == value2.y; }
+
+// Finds the key segment containing t in constant time. The [0, 1] range is split into
+// uniform buckets which remember the first segment overlapping them, so a search only
+// steps over keys sharing the bucket.
+class SegmentLookup
+{
+public:
+	static constexpr std::size_t Buckets = 32;
+
+private:
+	uint16_t firstSegments[Buckets] = {};
+
+public:
+	template<typename KeyValue>
+	void Build(const KeyValue* keyValues, std::size_t count)
+	{
+		std::size_t segment = 0;
+		for (std::size_t i = 0; i < Buckets; i++)
+		{
+			const float t = i / (float)Buckets;
+			while (segment + 2 < count && t >= keyValues [segment + 1].key) segment++;
+			firstSegments [i] = (uint16_t)segment;
+		}
+	}
+
+	// Index of the first key of the segment, count must be at least 2
+	template<typename KeyValue>
+	std::size_t Find(const KeyValue* keyValues, std::size_t count, float t) const
+	{
+		const std::size_t bucket = std::min((std::size_t)(Clamp01(t) * Buckets), Buckets - 1);
+
+		std::size_t segment = firstSegments [bucket];
+		while (segment + 2 < count && t >= keyValues [segment + 1].key) segment++;
+		return segment;
+	}
+};
+
+// Piecewise linear curve with up to MaxKeys keys, keys are expected in ascending order
+// and any past MaxKeys are dropped with an error. Evaluation is a bucket lookup and a lerp, with no virtual calls or divisions.
+template<typename T, std::size_t MaxKeys = 8>
+class Curve
+{
+public:
+	struct KeyValue
+	{
+		float key;
+		T value;
+	};
+
+private:
+	KeyValue keyValues[MaxKeys];
+	float inverseRanges[MaxKeys];
+	SegmentLookup lookup;
+	std::size_t length;
+
+public:
+	Curve(const std::initializer_list<KeyValue>& kvs) :
+		length(0)
+	{
+		for (const auto& kv : kvs)
+		{
+			if (length == MaxKeys)
+			{
+				ErrorLog("Curve holds at most %d keys, %d are dropped", (int)MaxKeys, (int)(kvs.size() - MaxKeys));
+				break;
+			}
+			keyValues [length++] = kv;
+		}
+		Rebuild();
+	}
+
+	void Add(const KeyValue keyValue)
+	{
+		if (length == MaxKeys)
+		{
+			ErrorLog("Curve holds at most %d keys, the key is dropped", (int)MaxKeys);
+			return;
+		}
+
+		keyValues [length++] = keyValue;
+		Rebuild();
+	}
+
+	// Returns a curve shared by every curve with the same keys. Interned curves
+	// live as long as the program, so they can be referenced by plain pointer from
+	// components that are copied per particle.
+	static const Curve* Intern(const std::initializer_list<KeyValue>& kvs)
+	{
+		static std::mutex mutex;
+		static std::vector<Scoped<const Curve>> curves;
+
+		const Curve curve(kvs);
+
+		std::lock_guard lock(mutex);
+		for (const auto& other : curves)
+		{
+			if (other->HasSameKeys(curve)) return other.get();
+		}
+
+		curves.push_back(MakeScoped<const Curve>(curve));
+		return curves.back().get();
+	}
+
+	std::size_t Size() const { return length; }
+
+	T Evaluate(float t) const
+	{
+		if (length < 1) return T {};
+		if (length < 2) return keyValues [0].value;
+
+		const std::size_t segment = lookup.Find(keyValues, length, t);
+		const auto& keyValue1 = keyValues [segment];
+		const auto& keyValue2 = keyValues [segment + 1];
+
+		return LerpValue(keyValue1.value, keyValue2.value, Clamp01((t - keyValue1.key) * inverseRanges [segment]));
+	}
+
+	void Evaluate(const float* t, T* out, std::size_t count) const
+	{
+		for (std::size_t i = 0; i < count; i++)
+		{
+			out [i] = Evaluate(t [i]);
+		}
+	}
+
+private:
+	bool HasSameKeys(const Curve& other) const
+	{
+		if (length != other.length) return false;
+
+		for (std::size_t i = 0; i < length; i++)
+		{
+			if (keyValues [i].key != other.keyValues [i].key || !IsSameValue(keyValues [i].value, other.keyValues [i].value)) return false;
+		}
+		return true;
+	}
+
+	void Rebuild()
+	{
+		for (std::size_t i = 0; i + 1 < length; i++)
+		{
+			const float range = keyValues [i + 1].key - keyValues [i].key;
+			inverseRanges [i] = range > 0.0f ? 1.0f / range : 0.0f;
+		}
+		lookup.Build(keyValues, length);
+	}
+};
\ No newline at end of file
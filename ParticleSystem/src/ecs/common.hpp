@@ -82,7 +82,8 @@ namespace ecs
 			ringDrawCompProto({}),
 			rectGradDrawCompProto({}),
 			roundedRectDrawCompProto({}),
-			emitterShape(nullptr)
+			emitterShape(nullptr),
+			random(0.f)
 		{
 		}
 
@@ -126,6 +127,12 @@ namespace ecs
 			return randomColor ? randomColor->Evaluate(random) : color; 
 		}
 
+		// Whether the optional attributes are set, without evaluating them
+		bool HasRotation() const { return randomRotation || rotation.has_value(); }
+		bool HasAcceleration() const { return randomAcceleration || acceleration.has_value(); }
+		bool HasAngularVelocity() const { return randomAngularVelocity || angularVelocity.has_value(); }
+		bool HasAngularAcceleration() const { return randomAngularAcceleration || angularAcceleration.has_value(); }
+
 		inline void Randomize() 
 		{
 			random = Random();
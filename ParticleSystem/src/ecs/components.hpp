@@ -1,38 +1,45 @@
 #pragma once
 
 #include "../common.hpp"
+#include "../curve.hpp"
+#include "../gradient.hpp"
 
 namespace ecs
 {
+	// Curves are interned, every particle with the same keys points to the same curve
 	template<typename T>
 	struct InterpolatorComponent
 	{
-		struct KeyValue
-		{
-			float key;
-			T value;
-		};
+		using KeyValue = typename Curve<T>::KeyValue;
 
-		KeyValue keyValues[8];
-		int length;
+		const Curve<T>* curve;
 		T interpolated;
 
-		InterpolatorComponent(const std::initializer_list<KeyValue>& kvs)
+		InterpolatorComponent(const std::initializer_list<KeyValue>& kvs) :
+			curve(Curve<T>::Intern(kvs)),
+			interpolated {}
 		{
-			assert(kvs.size() > 2 && kvs.size() <= 8);
-
-			size_t i = 0;
-			for (const auto& kv : kvs)
-			{
-				keyValues[i++] = kv;
-			}
-			length = (int)i;
+			assert(kvs.size() >= 2);
 		}
 	};
 
-	struct ColorOverLifetimeComponent : public InterpolatorComponent<Color>
+	// Colors are evaluated from a baked table shared by every particle with the same keys
+	struct ColorOverLifetimeComponent
 	{
-		using InterpolatorComponent<Color>::InterpolatorComponent;
+		struct KeyValue
+		{
+			float key;
+			Color value;
+		};
+
+		const BakedGradient* baked;
+		Color interpolated;
+
+		ColorOverLifetimeComponent(const std::initializer_list<KeyValue>& kvs) :
+			baked(BakedGradient::Intern(kvs.begin(), (int)kvs.size())),
+			interpolated {}
+		{
+		}
 	};
 
 	struct RotationOverLifetimeComponent : public InterpolatorComponent<float>
@@ -55,8 +62,6 @@ namespace ecs
 		using InterpolatorComponent<float>::InterpolatorComponent;
 	};
 
-	struct DestroyEntityComponent {};
-
 	struct PixelDrawComponent {};
 
 	struct CircleDrawComponent {};
@@ -93,7 +98,6 @@ namespace ecs
 	{
 		float lifetime;
 		float spawntime;
-		float t;
 	};
 
 	struct PositionComponent
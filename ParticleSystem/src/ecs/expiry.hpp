@@ -0,0 +1,128 @@
+#pragma once
+
+#include "../common.hpp"
+
+#include "common.hpp"
+
+namespace ecs
+{
+	// Timing wheel of entities keyed on their death time. Time is cut into slots of
+	// slotDuration seconds and an entity is filed in the slot its death time falls
+	// in, so advancing the wheel only visits the slots elapsed since the last
+	// advance: finding the expired entities costs O(expired) instead of O(alive).
+	// Deaths further out than the wheel spans wait in an overflow list, which is
+	// filed again every time the wheel completes a turn.
+	class ExpiryWheel
+	{
+		struct Entry
+		{
+			ps_entity entity;
+			float deathTime;
+		};
+
+		float slotDuration;
+		std::vector<std::vector<Entry>> slots;
+		std::vector<Entry> overflow;
+
+		// Absolute index of the slot holding the time of the last advance
+		int64_t current;
+		std::size_t count;
+
+		// Non copyable & moveable
+		ExpiryWheel(const ExpiryWheel&) = delete;
+		ExpiryWheel& operator=(const ExpiryWheel&) = delete;
+
+	public:
+		ExpiryWheel(float slotDuration = 1.0f / 64.0f, std::size_t slotCount = 512) :
+			slotDuration(slotDuration),
+			slots(slotCount),
+			current(0),
+			count(0)
+		{
+		}
+
+		std::size_t Count() const { return count; }
+
+		void Insert(ps_entity entity, float deathTime)
+		{
+			File({ entity, deathTime });
+			count++;
+		}
+
+		// Appends the entities whose death time is before time
+		void Advance(float time, std::vector<ps_entity>& expired)
+		{
+			const int64_t slotCount = (int64_t)slots.size();
+			const int64_t last = SlotOf(time);
+			if (last < current) return;
+
+			const std::size_t expiredBefore = expired.size();
+
+			// Slots passed entirely only hold expired entities, a jump of a whole turn or more empties the wheel
+			const int64_t end = std::min(last, current + slotCount);
+			for (int64_t slot = current; slot < end; slot++)
+			{
+				auto& entries = slots [Wrap(slot)];
+				for (const auto& entry : entries) expired.push_back(entry.entity);
+				entries.clear();
+			}
+
+			const bool isNewTurn = FloorDiv(last, slotCount) != FloorDiv(current, slotCount);
+			current = last;
+
+			if (isNewTurn && !overflow.empty())
+			{
+				std::vector<Entry> waiting;
+				waiting.swap(overflow);
+				for (const auto& entry : waiting) File(entry);
+			}
+
+			// The slot time is in is only partly elapsed
+			auto& entries = slots [Wrap(current)];
+			for (std::size_t i = 0; i < entries.size();)
+			{
+				if (entries [i].deathTime < time)
+				{
+					expired.push_back(entries [i].entity);
+					entries [i] = entries.back();
+					entries.pop_back();
+				}
+				else
+				{
+					i++;
+				}
+			}
+
+			count -= expired.size() - expiredBefore;
+		}
+
+	private:
+		int64_t SlotOf(float time) const { return (int64_t)std::floor(time / slotDuration); }
+
+		std::size_t Wrap(int64_t slot) const
+		{
+			const int64_t slotCount = (int64_t)slots.size();
+			return (std::size_t)(slot - FloorDiv(slot, slotCount) * slotCount);
+		}
+
+		static int64_t FloorDiv(int64_t a, int64_t b)
+		{
+			const int64_t quotient = a / b;
+			return quotient * b > a ? quotient - 1 : quotient;
+		}
+
+		// Already due entities go to the current slot, they expire on the next advance
+		void File(const Entry& entry)
+		{
+			const int64_t slot = std::max(SlotOf(entry.deathTime), current);
+			if (slot - current >= (int64_t)slots.size())
+			{
+				overflow.push_back(entry);
+			}
+			else
+			{
+				slots [Wrap(slot)].push_back(entry);
+			}
+		}
+	};
+}
\ No newline at end of file
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "../common.hpp"
+
+#include "common.hpp"
+
+namespace ecs
+{
+	// Storage of one component type. Capacity counts the slots allocated for
+	// components, dense bytes cover those slots plus the packed entity array and
+	// sparse bytes the entity to index lookup, its page table and allocated pages.
+	struct ComponentMemory
+	{
+		const char* name;
+		std::size_t count;
+		std::size_t capacity;
+		std::size_t denseBytes;
+		std::size_t sparseBytes;
+
+		std::size_t Bytes() const { return denseBytes + sparseBytes; }
+	};
+
+	struct RegistryMemory
+	{
+		std::vector<ComponentMemory> components;
+
+		std::size_t entities = 0;
+		std::size_t entityCapacity = 0;
+		std::size_t entityBytes = 0;
+
+		std::size_t componentCount = 0;
+		std::size_t componentCapacity = 0;
+		std::size_t componentBytes = 0;
+
+		std::size_t Bytes() const { return entityBytes + componentBytes; }
+	};
+
+	// The sparse array is paged, a page is allocated when the first entity of its id
+	// range gets the component and kept as long as the storage. The pages are marked
+	// as components are constructed, since the storage does not tell which are allocated.
+	class SparsePages
+	{
+		std::vector<bool> pages;
+		std::size_t count = 0;
+
+	public:
+		void Mark(ps_registry&, ps_entity entity)
+		{
+			const std::size_t page = entt::to_entity(entity) / ENTT_SPARSE_PAGE;
+
+			if (page >= pages.size()) pages.resize(page + 1, false);
+			if (pages [page]) return;
+
+			pages [page] = true;
+			count++;
+		}
+
+		std::size_t Count() const { return count; }
+	};
+
+	template<typename Component>
+	ComponentMemory MeasureComponent(const ps_registry& reg, const SparsePages& sparsePages, const char* name)
+	{
+		using Storage = std::remove_const_t<std::remove_reference_t<decltype(reg.storage<Component>())>>;
+		using SparseSet = typename Storage::base_type;
+
+		const Storage& storage = reg.storage<Component>();
+		const SparseSet& set = storage;
+
+		// Qualified so the storage's payload capacity does not stand in for the packed array's
+		const auto packedCapacity = set.SparseSet::capacity();
+
+		// Empty components are never instantiated, only their entities are stored
+		const auto capacity = std::is_empty_v<Component> ? packedCapacity : storage.capacity();
+		const auto payloadBytes = std::is_empty_v<Component> ? 0 : capacity * sizeof(Component);
+
+		return {
+			name,
+			storage.size(),
+			capacity,
+			packedCapacity * sizeof(ps_entity) + payloadBytes,
+			set.extent() / ENTT_SPARSE_PAGE * sizeof(ps_entity*) + sparsePages.Count() * ENTT_SPARSE_PAGE * sizeof(ps_entity)
+		};
+	}
+
+	// Measures the registry's entity pool and the components added through Add.
+	// Components must be added before any entity gets them.
+	class MemoryAccounting
+	{
+		std::vector<std::function<ComponentMemory(const ps_registry&)>> measureFunctions;
+		std::vector<Scoped<SparsePages>> sparsePages;
+
+	public:
+		template<typename Component>
+		void Add(ps_registry& reg, const char* name)
+		{
+			auto& pages = *sparsePages.emplace_back(MakeScoped<SparsePages>());
+			reg.on_construct<Component>().template connect<&SparsePages::Mark>(pages);
+
+			measureFunctions.push_back([name, &pages](const ps_registry& reg) { return MeasureComponent<Component>(reg, pages, name); });
+		}
+
+		RegistryMemory Measure(const ps_registry& reg) const
+		{
+			RegistryMemory memory;
+			memory.components.reserve(measureFunctions.size());
+
+			memory.entities = reg.alive();
+			memory.entityCapacity = reg.capacity();
+			memory.entityBytes = reg.capacity() * sizeof(ps_entity);
+
+			for (const auto& measureFunction : measureFunctions)
+			{
+				const auto& component = memory.components.emplace_back(measureFunction(reg));
+				memory.componentCount += component.count;
+				memory.componentCapacity += component.capacity;
+				memory.componentBytes += component.Bytes();
+			}
+
+			return memory;
+		}
+	};
+}
\ No newline at end of file
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "../common.hpp"
+#include "../instrumentation.hpp"
+#include "../threadpool.hpp"
+
+#include <typeindex>
+
+namespace ecs
+{
+	// Component access declarations used when adding systems to the scheduler
+	template<typename... Components>
+	struct Read {};
+
+	template<typename... Components>
+	struct Write {};
+
+	// Runs systems on a thread pool while respecting their declared component access.
+	// Systems are ordered by the order they were added in, a system depends on every
+	// earlier system it conflicts with (one writes what the other reads or writes).
+	// Systems without a path between them in the resulting DAG run in parallel.
+	class Scheduler
+	{
+		struct System
+		{
+			const char* name;
+			std::function<void()> run;
+			std::vector<std::type_index> reads;
+			std::vector<std::type_index> writes;
+			bool isExclusive;
+
+			std::vector<std::size_t> dependents;
+			uint32_t dependencyCount;
+		};
+
+		std::vector<System> systems;
+		std::unique_ptr<std::atomic<uint32_t>[]> pending;
+
+		// Systems left to run, only changed while holding mutex so the waiter can not
+		// return and destroy the scheduler while a worker still signals it
+		std::mutex mutex;
+		std::size_t remaining;
+		std::condition_variable finished;
+
+		bool isBuilt;
+
+		// Non copyable & moveable
+		Scheduler(const Scheduler&) = delete;
+		Scheduler& operator=(const Scheduler&) = delete;
+
+	public:
+		Scheduler() :
+			remaining(0),
+			isBuilt(false)
+		{
+		}
+
+		template<typename... Reads, typename... Writes, typename Function>
+		void Add(const char* name, Read<Reads...>, Write<Writes...>, Function function)
+		{
+			systems.push_back({ name, std::move(function), { typeid(Reads)... }, { typeid(Writes)... }, false, {}, 0 });
+			isBuilt = false;
+		}
+
+		// Exclusive systems may change the entity set, so they conflict with every other system
+		template<typename Function>
+		void AddExclusive(const char* name, Function function)
+		{
+			systems.push_back({ name, std::move(function), {}, {}, true, {}, 0 });
+			isBuilt = false;
+		}
+
+		void Build()
+		{
+			PROFILE_FUNCTION();
+
+			for (auto& system : systems)
+			{
+				system.dependents.clear();
+				system.dependencyCount = 0;
+			}
+
+			for (std::size_t i = 0; i < systems.size(); i++)
+			{
+				for (std::size_t j = i + 1; j < systems.size(); j++)
+				{
+					if (Conflicts(systems [i], systems [j]))
+					{
+						systems [i].dependents.push_back(j);
+						systems [j].dependencyCount++;
+					}
+				}
+			}
+
+			pending = std::make_unique<std::atomic<uint32_t>[]>(systems.size());
+			isBuilt = true;
+		}
+
+		// Blocks until every system has run
+		void Run(ThreadPool& pool)
+		{
+			PROFILE_FUNCTION();
+
+			if (!isBuilt) Build();
+			if (systems.empty()) return;
+
+			{
+				std::lock_guard lock(mutex);
+				remaining = systems.size();
+			}
+
+			for (std::size_t i = 0; i < systems.size(); i++)
+			{
+				pending [i] = systems [i].dependencyCount;
+			}
+
+			for (std::size_t i = 0; i < systems.size(); i++)
+			{
+				if (systems [i].dependencyCount == 0) Dispatch(pool, i);
+			}
+
+			std::unique_lock lock(mutex);
+			finished.wait(lock, [this] { return remaining == 0; });
+		}
+
+	private:
+		static bool Intersects(const std::vector<std::type_index>& a, const std::vector<std::type_index>& b)
+		{
+			for (const auto& type : a)
+			{
+				if (std::find(b.begin(), b.end(), type) != b.end()) return true;
+			}
+			return false;
+		}
+
+		static bool Conflicts(const System& a, const System& b)
+		{
+			if (a.isExclusive || b.isExclusive) return true;
+
+			return Intersects(a.writes, b.reads) || Intersects(a.writes, b.writes) || Intersects(a.reads, b.writes);
+		}
+
+		void Dispatch(ThreadPool& pool, std::size_t index)
+		{
+			pool.Submit([this, &pool, index]
+				{
+					const auto& system = systems [index];
+					system.run();
+
+					for (const auto dependent : system.dependents)
+					{
+						if (--pending [dependent] == 0) Dispatch(pool, dependent);
+					}
+
+					std::lock_guard lock(mutex);
+					if (--remaining == 0) finished.notify_one();
+				});
+		}
+	};
+}
@@ -2,370 +2,737 @@
 
 #include "../common.hpp"
 #include "../instrumentation.hpp"
+#include "../metrics.hpp"
+#include "../kinematics.hpp"
+#include "../renderbackend.hpp"
 
 #include "common.hpp"
 #include "components.hpp"
+#include "expiry.hpp"
+
+#include <typeindex>
 
 namespace ecs
 {
 	static const auto EXECUTION_POLICY = std::execution::par_unseq;
 
-	// Destroy All Entities Marked for Destruction
-	void DestroyEntitySystem(ps_registry& reg)
+	// Runs function(first, count) over [0, count) in chunks of chunkSize, chunks are processed in parallel
+	template<typename Function>
+	void ParallelForChunks(std::size_t count, std::size_t chunkSize, Function function)
 	{
-		PROFILE_FUNCTION();
+		std::vector<std::size_t> chunks((count + chunkSize - 1) / chunkSize);
+		std::iota(chunks.begin(), chunks.end(), 0);
 
-		auto destroyEntityView = reg.view<DestroyEntityComponent>();
-		reg.destroy(destroyEntityView.begin(), destroyEntityView.end());
+		std::for_each(EXECUTION_POLICY, chunks.begin(), chunks.end(), [count, chunkSize, &function](std::size_t chunk)
+			{
+				const auto first = chunk * chunkSize;
+				function(first, std::min(chunkSize, count - first));
+			});
 	}
 
-	_NODISCARD std::thread LifetimeUpdateSystem(ps_registry& reg, float time)
+	// Every particle carries these components, so they are owned by a group: their
+	// storages keep the particles at the front in the same order, index i of each
+	// one is the same particle. The nested group packs the accelerated particles first.
+	// A storage can only be owned by one chain of nested groups, the over lifetime and
+	// draw components are instead tracked against the group's order (GroupFollowers).
+	auto ParticleGroup(ps_registry& reg)
 	{
-		PROFILE_FUNCTION();
+		return reg.group<LifetimeComponent, PositionComponent, VelocityComponent, SizeComponent, ColorComponent>();
+	}
+
+	auto AcceleratedParticleGroup(ps_registry& reg)
+	{
+		return reg.group<LifetimeComponent, PositionComponent, VelocityComponent, SizeComponent, ColorComponent, AccelerationComponent>();
+	}
+
+	// True when the storage holds exactly the particles, in the group's order. Compares every entity.
+	template<typename Component>
+	bool FollowsParticleGroup(ps_registry& reg)
+	{
+		auto group = ParticleGroup(reg);
+		const auto& storage = reg.storage<Component>();
+		return storage.size() == group.size() && std::equal(group.data(), group.data() + group.size(), storage.data());
+	}
+
+	// Which storages follow the particle group, so the systems don't compare them every frame.
+	// A burst appends the components of its particles together and destroying removes them
+	// together, so a following storage keeps following as long as its size matches the group's.
+	// That only holds while the nested group spans none or all of the particles, otherwise it
+	// reorders the owned storages. A storage that stopped following is compared in full once
+	// both hold again.
+	class GroupFollowers
+	{
+		struct Follower
+		{
+			std::size_t (*size)(const ps_registry&);
+			bool (*compare)(ps_registry&);
+			bool follows;
+			bool isCandidate;
+		};
+
+		std::unordered_map<std::type_index, Follower> followers;
+
+	public:
+		// Components must be added before any entity gets them
+		template<typename Component>
+		void Add()
+		{
+			followers.emplace(typeid(Component), Follower{
+				[](const ps_registry& reg) { return reg.storage<Component>().size(); },
+				[](ps_registry& reg) { return FollowsParticleGroup<Component>(reg); },
+				true,
+				true
+				});
+		}
+
+		template<typename Component>
+		bool Follows() const
+		{
+			return followers.at(typeid(Component)).follows;
+		}
+
+		// After particles were spawned or destroyed
+		void Update(ps_registry& reg)
+		{
+			const auto groupSize = ParticleGroup(reg).size();
+			const auto acceleratedSize = AcceleratedParticleGroup(reg).size();
+			const bool isOrderKept = acceleratedSize == 0 || acceleratedSize == groupSize;
+
+			for (auto& [type, follower] : followers)
+			{
+				const bool isCandidate = isOrderKept && follower.size(reg) == groupSize;
+
+				if (follower.follows) follower.follows = isCandidate;
+				else if (isCandidate && !follower.isCandidate) follower.follows = follower.compare(reg);
+
+				follower.isCandidate = isCandidate;
+			}
+		}
 
-		std::thread thread([](ps_registry& reg, float time)
+		// After components were added or removed outside of bursts, every storage is compared on the next update
+		void Invalidate()
+		{
+			for (auto& [type, follower] : followers)
 			{
-				PROFILE_THREAD("LifetimeUpdateThread");
+				follower.follows = false;
+				follower.isCandidate = false;
+			}
+		}
+	};
 
-				// Update all Lifecycle Components
-				reg.view<LifetimeComponent>()
-					.each([&registry = reg, time](const auto entity, LifetimeComponent& lifetimeComponent)
-						{
-							float t = time - lifetimeComponent.spawntime;
+	static constexpr std::size_t PACKED_PAGE_SIZE = entt::component_traits<PositionComponent>::page_size;
 
-							if (t > lifetimeComponent.lifetime)
-							{
+	// Components by packed index, contiguous up to the end of their storage page
+	template<typename Component>
+	class PackedStorage
+	{
+		using Storage = std::remove_reference_t<decltype(std::declval<ps_registry&>().storage<std::remove_const_t<Component>>())>;
+		using Pages = decltype(std::declval<Storage&>().raw());
 
-								registry.emplace<DestroyEntityComponent>(entity);
-							}
+		Pages pages;
 
-							lifetimeComponent.t = t / lifetimeComponent.lifetime;
-						});
-			}, std::ref(reg), time);
+		static_assert(entt::component_traits<std::remove_const_t<Component>>::page_size == PACKED_PAGE_SIZE);
 
-		return std::move(thread);
-	}
+	public:
+		PackedStorage(ps_registry& reg) :
+			pages(reg.storage<std::remove_const_t<Component>>().raw())
+		{
+		}
+
+		Component* At(std::size_t index) const { return pages [index / PACKED_PAGE_SIZE] + index % PACKED_PAGE_SIZE; }
+	};
 
-	_NODISCARD std::thread KinematicUpdateSystem(ps_registry& reg, float dt)
+	// Runs function(first, count) over [begin, end) in parallel chunks that never cross a storage page,
+	// so a chunk is contiguous in every storage owned by or following the particle group
+	template<typename Function>
+	void ParallelForPages(std::size_t begin, std::size_t end, Function function)
 	{
-		PROFILE_FUNCTION();
+		if (begin >= end) return;
+
+		const auto firstPage = begin / PACKED_PAGE_SIZE;
+		const auto pageCount = (end - 1) / PACKED_PAGE_SIZE - firstPage + 1;
 
-		std::thread thread([](ps_registry& reg, float dt)
+		ParallelForChunks(pageCount, 1, [begin, end, firstPage, &function](std::size_t page, std::size_t)
 			{
-				PROFILE_THREAD("KinematicUpdateThread");
+				const auto first = std::max(begin, (firstPage + page) * PACKED_PAGE_SIZE);
+				const auto last = std::min(end, (firstPage + page + 1) * PACKED_PAGE_SIZE);
+				function(first, last - first);
+			});
+	}
 
-				auto view = reg.view<PositionComponent, VelocityComponent, const AccelerationComponent>();
-				std::for_each(EXECUTION_POLICY, view.begin(), view.end(), [&view, dt](auto entity)
-					{
-						auto [positionComponent, velocityComponent, accelerationComponent] = view.get<PositionComponent, VelocityComponent, const AccelerationComponent>(entity);
+	// Entities found dead by a parallel pass. Every chunk of the pass has its own list, a chunk
+	// runs on a single worker so no list is shared between threads. The lists are merged once
+	// the pass is over and keep their capacity from frame to frame.
+	class DeadEntities
+	{
+		std::vector<std::vector<ps_entity>> lists;
+		std::vector<ps_entity> merged;
 
-						velocityComponent.velocity.x += accelerationComponent.acceleration.x * dt;
-						velocityComponent.velocity.y += accelerationComponent.acceleration.y * dt;
+	public:
+		void Reserve(std::size_t chunkCount)
+		{
+			if (lists.size() < chunkCount) lists.resize(chunkCount);
+		}
 
-						const float half = 0.5f;
+		std::vector<ps_entity>& List(std::size_t chunk) { return lists [chunk]; }
 
-						positionComponent.position.x += velocityComponent.velocity.x * dt + half * accelerationComponent.acceleration.x * dt * dt;
-						positionComponent.position.y += velocityComponent.velocity.y * dt + half * accelerationComponent.acceleration.y * dt * dt;
-					});
-			}, std::ref(reg), dt);
+		// Sorted, so the sparse arrays are walked in ascending order when the entities are removed
+		const std::vector<ps_entity>& Merge()
+		{
+			merged.clear();
+			for (auto& list : lists)
+			{
+				merged.insert(merged.end(), list.begin(), list.end());
+				list.clear();
+			}
 
-		return std::move(thread);
+			std::sort(merged.begin(), merged.end());
+			return merged;
+		}
+	};
+
+	// Destroys the entities found dead by the last lifetime pass. A range of entities not
+	// coming from a storage is removed pool by pool, then the identifiers are released.
+	std::size_t DestroyEntitySystem(ps_registry& reg, DeadEntities& dead)
+	{
+		PROFILE_FUNCTION();
+		METRICS_SCOPE("ecs.DestroyEntitySystem");
+
+		const auto& entities = dead.Merge();
+		reg.destroy(entities.begin(), entities.end());
+		return entities.size();
 	}
 
-	_NODISCARD std::thread PositionUpdateSystem(ps_registry& reg, float dt)
+	// Only the particles due by now are visited, the wheel was filled as they spawned
+	void LifetimeUpdateSystem(ps_registry& reg, float time, ExpiryWheel& expiryWheel, DeadEntities& dead)
 	{
 		PROFILE_FUNCTION();
+		METRICS_SCOPE("ecs.LifetimeUpdateSystem");
+
+		dead.Reserve(1);
+		auto& list = dead.List(0);
+
+		const auto first = list.size();
+		expiryWheel.Advance(time, list);
 
-		std::thread thread([](ps_registry& reg, float dt)
+		// Entities destroyed by other means since they were filed are dropped
+		list.erase(std::remove_if(list.begin() + first, list.end(), [&reg](ps_entity entity) { return !reg.valid(entity); }), list.end());
+	}
+
+	template<typename... Components, typename Function>
+	void EachPackedChunk(const std::tuple<PackedStorage<Components>...>& storages, std::size_t first, std::size_t count, Function& function)
+	{
+		std::apply([first, count, &function](const auto&... storage)
 			{
-				PROFILE_THREAD("PositionUpdateThread");
+				const auto chunks = std::make_tuple(storage.At(first)...);
+				for (std::size_t i = 0; i < count; i++)
+				{
+					std::apply([i, &function](auto*... chunk) { function(chunk [i]...); }, chunks);
+				}
+			}, storages);
+	}
 
-				auto positionVelocityView = reg.view<PositionComponent, const VelocityComponent>(entt::exclude<AccelerationComponent>);
-				std::for_each(EXECUTION_POLICY, positionVelocityView.begin(), positionVelocityView.end(), [&positionVelocityView, dt](auto entity)
-					{
-						auto [positionComponent, velocityComponent] = positionVelocityView.get<PositionComponent, const VelocityComponent>(entity);
-						positionComponent.position.x += velocityComponent.velocity.x * dt;
-						positionComponent.position.y += velocityComponent.velocity.y * dt;
-					});
-			}, std::ref(reg), dt);
+	// Calls function(Components&...) for every particle, walking the storages by index.
+	// Each storage must be owned by or follow the particle group.
+	template<typename... Components, typename Function>
+	void EachPackedParticle(ps_registry& reg, Function function)
+	{
+		const auto storages = std::make_tuple(PackedStorage<Components>(reg)...);
+		const auto count = ParticleGroup(reg).size();
 
-		return std::move(thread);
+		for (std::size_t first = 0; first < count; first += PACKED_PAGE_SIZE)
+		{
+			EachPackedChunk(storages, first, std::min(PACKED_PAGE_SIZE, count - first), function);
+		}
+	}
+
+	// Same as EachPackedParticle, pages are processed in parallel
+	template<typename... Components, typename Function>
+	void ParallelEachPackedParticle(ps_registry& reg, Function function)
+	{
+		const auto storages = std::make_tuple(PackedStorage<Components>(reg)...);
+
+		ParallelForPages(0, ParticleGroup(reg).size(), [&storages, &function](std::size_t first, std::size_t count)
+			{
+				EachPackedChunk(storages, first, count, function);
+			});
 	}
 
-	_NODISCARD std::thread ApplyInterpolatedVelocitySystem(ps_registry& reg)
+	// Particles in [begin, end) of the group are gathered page by page so the integration kernels can run over them
+	void KinematicUpdateSystem(ps_registry& reg, float dt)
 	{
 		PROFILE_FUNCTION();
+		METRICS_SCOPE("ecs.KinematicUpdateSystem");
 
-		std::thread thread([](ps_registry& reg)
+		const PackedStorage<PositionComponent> positionStorage(reg);
+		const PackedStorage<VelocityComponent> velocityStorage(reg);
+		const PackedStorage<const AccelerationComponent> accelerationStorage(reg);
+
+		ParallelForPages(0, AcceleratedParticleGroup(reg).size(), [&, dt](std::size_t first, std::size_t count)
 			{
-				PROFILE_THREAD("ApplyInterpolatedVelocityThread");
+				PositionComponent* positionComponents = positionStorage.At(first);
+				VelocityComponent* velocityComponents = velocityStorage.At(first);
+				const AccelerationComponent* accelerationComponents = accelerationStorage.At(first);
+
+				Vector2 positions[PACKED_PAGE_SIZE];
+				Vector2 velocities[PACKED_PAGE_SIZE];
+				Vector2 accelerations[PACKED_PAGE_SIZE];
+
+				for (std::size_t i = 0; i < count; i++)
+				{
+					positions[i] = positionComponents[i].position;
+					velocities[i] = velocityComponents[i].velocity;
+					accelerations[i] = accelerationComponents[i].acceleration;
+				}
 
-				auto view = reg.view<VelocityComponent, const VelocityOverLifetimeComponent>();
-				std::for_each(EXECUTION_POLICY, view.begin(), view.end(), [&view](auto entity)
-					{
-						auto [velocityComponent, velocityOverLifetimeComponent] = view.get<VelocityComponent, const VelocityOverLifetimeComponent>(entity);
-						velocityComponent.velocity = velocityOverLifetimeComponent.interpolated;
-					});
-			}, std::ref(reg));
+				kinematics::Integrate(positions, velocities, accelerations, count, dt);
 
-		return std::move(thread);
+				for (std::size_t i = 0; i < count; i++)
+				{
+					positionComponents[i].position = positions[i];
+					velocityComponents[i].velocity = velocities[i];
+				}
+			});
 	}
 
-	_NODISCARD std::thread ApplyInterpolatedSizeSystem(ps_registry& reg)
+	// Particles without acceleration follow the accelerated ones in the group
+	void PositionUpdateSystem(ps_registry& reg, float dt)
 	{
 		PROFILE_FUNCTION();
+		METRICS_SCOPE("ecs.PositionUpdateSystem");
+
+		const PackedStorage<PositionComponent> positionStorage(reg);
+		const PackedStorage<const VelocityComponent> velocityStorage(reg);
 
-		std::thread thread([](ps_registry& reg)
+		ParallelForPages(AcceleratedParticleGroup(reg).size(), ParticleGroup(reg).size(), [&, dt](std::size_t first, std::size_t count)
 			{
-				PROFILE_THREAD("ApplyInterpolatedSizeThread");
+				PositionComponent* positionComponents = positionStorage.At(first);
+				const VelocityComponent* velocityComponents = velocityStorage.At(first);
 
-				auto view = reg.view<SizeComponent, const SizeOverLifetimeComponent, const LifetimeComponent>();
-				std::for_each(EXECUTION_POLICY, view.begin(), view.end(), [&view](auto entity)
-					{
-						auto [sizeComponent, sizeOverLifetimeComponent] = view.get<SizeComponent, const SizeOverLifetimeComponent>(entity);
-						sizeComponent.size = sizeOverLifetimeComponent.interpolated;
-					});
-			}, std::ref(reg));
+				Vector2 positions[PACKED_PAGE_SIZE];
+				Vector2 velocities[PACKED_PAGE_SIZE];
 
-		return std::move(thread);
+				for (std::size_t i = 0; i < count; i++)
+				{
+					positions[i] = positionComponents[i].position;
+					velocities[i] = velocityComponents[i].velocity;
+				}
+
+				kinematics::Advance(positions, velocities, count, dt);
+
+				for (std::size_t i = 0; i < count; i++)
+				{
+					positionComponents[i].position = positions[i];
+				}
+			});
 	}
 
-	_NODISCARD std::thread ApplyInterpolatedColorSystem(ps_registry& reg)
+	void ApplyInterpolatedVelocitySystem(ps_registry& reg, const GroupFollowers& followers)
 	{
 		PROFILE_FUNCTION();
+		METRICS_SCOPE("ecs.ApplyInterpolatedVelocitySystem");
 
-		std::thread thread([](ps_registry& reg)
+		if (followers.Follows<VelocityOverLifetimeComponent>())
+		{
+			ParallelEachPackedParticle<VelocityComponent, const VelocityOverLifetimeComponent>(reg,
+				[](VelocityComponent& velocityComponent, const VelocityOverLifetimeComponent& velocityOverLifetimeComponent)
+				{
+					velocityComponent.velocity = velocityOverLifetimeComponent.interpolated;
+				});
+			return;
+		}
+
+		auto view = reg.view<VelocityComponent, const VelocityOverLifetimeComponent>();
+		std::for_each(EXECUTION_POLICY, view.begin(), view.end(), [&view](auto entity)
 			{
-				PROFILE_THREAD("ApplyInterpolatedColorThread");
+				auto [velocityComponent, velocityOverLifetimeComponent] = view.get<VelocityComponent, const VelocityOverLifetimeComponent>(entity);
+				velocityComponent.velocity = velocityOverLifetimeComponent.interpolated;
+			});
+	}
 
-				auto colorView = reg.view<ColorComponent, const ColorOverLifetimeComponent, const LifetimeComponent>();
-				std::for_each(EXECUTION_POLICY, colorView.begin(), colorView.end(), [&colorView](auto entity)
-					{
-						auto [colorComponent, colorOverLifetimeComponent] = colorView.get<ColorComponent, const ColorOverLifetimeComponent>(entity);
-						colorComponent.color = colorOverLifetimeComponent.interpolated;
-					});
-			}, std::ref(reg));
+	void ApplyInterpolatedSizeSystem(ps_registry& reg, const GroupFollowers& followers)
+	{
+		PROFILE_FUNCTION();
+		METRICS_SCOPE("ecs.ApplyInterpolatedSizeSystem");
 
-		return std::move(thread);
+		if (followers.Follows<SizeOverLifetimeComponent>())
+		{
+			ParallelEachPackedParticle<SizeComponent, const SizeOverLifetimeComponent>(reg,
+				[](SizeComponent& sizeComponent, const SizeOverLifetimeComponent& sizeOverLifetimeComponent)
+				{
+					sizeComponent.size = sizeOverLifetimeComponent.interpolated;
+				});
+			return;
+		}
+
+		auto view = reg.view<SizeComponent, const SizeOverLifetimeComponent, const LifetimeComponent>();
+		std::for_each(EXECUTION_POLICY, view.begin(), view.end(), [&view](auto entity)
+			{
+				auto [sizeComponent, sizeOverLifetimeComponent] = view.get<SizeComponent, const SizeOverLifetimeComponent>(entity);
+				sizeComponent.size = sizeOverLifetimeComponent.interpolated;
+			});
 	}
 
-	void Interpolate(InterpolatorComponent<float>& interpolator, const LifetimeComponent& lifetime)
+	void ApplyInterpolatedColorSystem(ps_registry& reg, const GroupFollowers& followers)
 	{
-		int index1 = 0;
-		int index2 = 0;
+		PROFILE_FUNCTION();
+		METRICS_SCOPE("ecs.ApplyInterpolatedColorSystem");
 
-		for (int i = 0; i < interpolator.length - 1; i++)
+		if (followers.Follows<ColorOverLifetimeComponent>())
 		{
-			if (lifetime.t >= interpolator.keyValues[i].key && lifetime.t < interpolator.keyValues[i + 1].key)
-			{
-				index1 = i;
-				index2 = i + 1;
-				break;
-			}
+			ParallelEachPackedParticle<ColorComponent, const ColorOverLifetimeComponent>(reg,
+				[](ColorComponent& colorComponent, const ColorOverLifetimeComponent& colorOverLifetimeComponent)
+				{
+					colorComponent.color = colorOverLifetimeComponent.interpolated;
+				});
+			return;
 		}
 
-		const auto& a = interpolator.keyValues[index1];
-		const auto& b = interpolator.keyValues[index2];
-		const float t = (lifetime.t - a.key) / (b.key - a.key);
+		auto colorView = reg.view<ColorComponent, const ColorOverLifetimeComponent, const LifetimeComponent>();
+		std::for_each(EXECUTION_POLICY, colorView.begin(), colorView.end(), [&colorView](auto entity)
+			{
+				auto [colorComponent, colorOverLifetimeComponent] = colorView.get<ColorComponent, const ColorOverLifetimeComponent>(entity);
+				colorComponent.color = colorOverLifetimeComponent.interpolated;
+			});
+	}
+
+	// Age as a fraction of the lifetime, computed by the systems needing it
+	float NormalizedAge(const LifetimeComponent& lifetime, float time)
+	{
+		return (time - lifetime.spawntime) / lifetime.lifetime;
+	}
 
-		interpolator.interpolated = Lerp(a.value, b.value, t);
+	template<typename T>
+	void Interpolate(InterpolatorComponent<T>& interpolator, const LifetimeComponent& lifetime, float time)
+	{
+		interpolator.interpolated = interpolator.curve->Evaluate(NormalizedAge(lifetime, time));
 	}
 
-	void Interpolate(InterpolatorComponent<Vector2>& interpolator, const LifetimeComponent& lifetime)
+	void Interpolate(ColorOverLifetimeComponent& interpolator, const LifetimeComponent& lifetime, float time)
 	{
-		int index1 = 0;
-		int index2 = 0;
+		interpolator.interpolated = interpolator.baked->Evaluate(NormalizedAge(lifetime, time));
+	}
 
-		for (int i = 0; i < interpolator.length - 1; i++)
+	template<typename Component>
+	void InterpolateOverLifetime(ps_registry& reg, const GroupFollowers& followers, float time)
+	{
+		if (followers.Follows<Component>())
 		{
-			if (lifetime.t >= interpolator.keyValues[i].key && lifetime.t < interpolator.keyValues[i + 1].key)
-			{
-				index1 = i;
-				index2 = i + 1;
-				break;
-			}
+			ParallelEachPackedParticle<Component, const LifetimeComponent>(reg, [time](Component& component, const LifetimeComponent& lifetimeComponent)
+				{
+					Interpolate(component, lifetimeComponent, time);
+				});
+			return;
 		}
 
-		const auto& a = interpolator.keyValues[index1];
-		const auto& b = interpolator.keyValues[index2];
-		const float t = (lifetime.t - a.key) / (b.key - a.key);
+		auto view = reg.view<Component, const LifetimeComponent>();
+		std::for_each(EXECUTION_POLICY, view.begin(), view.end(), [&view, time](auto entity)
+			{
+				auto [component, lifetimeComponent] = view.template get<Component, const LifetimeComponent>(entity);
+				Interpolate(component, lifetimeComponent, time);
+			});
+	}
 
-		interpolator.interpolated = Vector2Lerp(a.value, b.value, t);
+	void InterpolateColorSystem(ps_registry& reg, const GroupFollowers& followers, float time)
+	{
+		PROFILE_FUNCTION();
+		METRICS_SCOPE("ecs.InterpolateColorSystem");
+
+		InterpolateOverLifetime<ColorOverLifetimeComponent>(reg, followers, time);
 	}
 
-	void Interpolate(InterpolatorComponent<Color>& interpolator, const LifetimeComponent& lifetime)
+	void InterpolateRotationSystem(ps_registry& reg, const GroupFollowers& followers, float time)
 	{
-		int index1 = 0;
-		int index2 = 0;
+		PROFILE_FUNCTION();
+		METRICS_SCOPE("ecs.InterpolateRotationSystem");
 
-		for (int i = 0; i < interpolator.length - 1; i++)
-		{
-			if (lifetime.t >= interpolator.keyValues[i].key && lifetime.t < interpolator.keyValues[i + 1].key)
-			{
-				index1 = i;
-				index2 = i + 1;
-				break;
-			}
-		}
+		InterpolateOverLifetime<RotationOverLifetimeComponent>(reg, followers, time);
+	}
 
-		const auto& a = interpolator.keyValues[index1];
-		const auto& b = interpolator.keyValues[index2];
-		const float t = (lifetime.t - a.key) / (b.key - a.key);
+	void InterpolateSizeSystem(ps_registry& reg, const GroupFollowers& followers, float time)
+	{
+		PROFILE_FUNCTION();
+		METRICS_SCOPE("ecs.InterpolateSizeSystem");
 
-		Vector3 hsv1 = ColorToHSV(a.value);
-		Vector3 hsv2 = ColorToHSV(b.value);
-		Vector3 hsv = Vector3Lerp(hsv1, hsv2, t);
-		interpolator.interpolated = ColorAlpha(ColorFromHSV(hsv.x, hsv.y, hsv.z), Lerp(a.value.a / 255.0f, b.value.a / 255.0f, t));
+		InterpolateOverLifetime<SizeOverLifetimeComponent>(reg, followers, time);
 	}
 
-	_NODISCARD std::thread InterpolateColorSystem(ps_registry& reg)
+	void InterpolateVelocitySystem(ps_registry& reg, const GroupFollowers& followers, float time)
 	{
 		PROFILE_FUNCTION();
+		METRICS_SCOPE("ecs.InterpolateVelocitySystem");
 
-		std::thread thread([](ps_registry& reg)
-			{
-				PROFILE_THREAD("InterpolateColorThread");
+		InterpolateOverLifetime<VelocityOverLifetimeComponent>(reg, followers, time);
+	}
 
-				auto colorOverLifetimeView = reg.view<ColorOverLifetimeComponent, const LifetimeComponent>();
-				std::for_each(EXECUTION_POLICY, colorOverLifetimeView.begin(), colorOverLifetimeView.end(), [&colorOverLifetimeView](auto entity)
-					{
-						auto [colorOverLifeComponent, lifetimeComponent] = colorOverLifetimeView.get<ColorOverLifetimeComponent, const LifetimeComponent>(entity);
-						Interpolate(colorOverLifeComponent, lifetimeComponent);
-					});
-			}, std::ref(reg));
+	void InterpolateAngularVelocitySystem(ps_registry& reg, const GroupFollowers& followers, float time)
+	{
+		PROFILE_FUNCTION();
+		METRICS_SCOPE("ecs.InterpolateAngularVelocitySystem");
 
-		return std::move(thread);
+		InterpolateOverLifetime<AngularVelocityOverLifetimeComponent>(reg, followers, time);
 	}
 
-	_NODISCARD std::thread InterpolateRotationSystem(ps_registry& reg)
+	// Where a particle is drawn, offset seconds ahead of its last simulated position
+	Vector2 RenderPosition(const PositionComponent& pos, const VelocityComponent& vel, float offset)
+	{
+		return Vector2Add(pos.position, Vector2Scale(vel.velocity, offset));
+	}
+
+	void PackPixelSystem(ps_registry& reg, const GroupFollowers& followers, ShapeInstanceBuffer& instances, float offset)
 	{
 		PROFILE_FUNCTION();
+		METRICS_SCOPE("ecs.PackPixelSystem");
 
-		std::thread thread([](ps_registry& reg)
+		auto pack = [&instances, offset](const PositionComponent& pos, const VelocityComponent& vel, const ColorComponent& color)
 			{
-				PROFILE_THREAD("InterpolateRotationThread");
+				instances.AddRect(RenderPosition(pos, vel, offset), { 1.0f, 1.0f }, color.color);
+			};
 
-				auto rotationOverLifetimeView = reg.view<RotationOverLifetimeComponent, const LifetimeComponent>();
-				std::for_each(EXECUTION_POLICY, rotationOverLifetimeView.begin(), rotationOverLifetimeView.end(), [&rotationOverLifetimeView](auto entity)
-					{
-						auto [rotOverLifeComponent, lifetimeComponent] = rotationOverLifetimeView.get<RotationOverLifetimeComponent, const LifetimeComponent>(entity);
-						Interpolate(rotOverLifeComponent, lifetimeComponent);
-					});
-			}, std::ref(reg));
-
-		return std::move(thread);
+		if (followers.Follows<PixelDrawComponent>())
+		{
+			EachPackedParticle<const PositionComponent, const VelocityComponent, const ColorComponent>(reg, pack);
+		}
+		else
+		{
+			reg.view<const PositionComponent, const VelocityComponent, const ColorComponent, const PixelDrawComponent>().each(pack);
+		}
 	}
 
-	_NODISCARD std::thread InterpolateSizeSystem(ps_registry& reg)
+	void PackCircleSystem(ps_registry& reg, const GroupFollowers& followers, ShapeInstanceBuffer& instances, float offset)
 	{
 		PROFILE_FUNCTION();
+		METRICS_SCOPE("ecs.PackCircleSystem");
 
-		std::thread thread([](ps_registry& reg)
+		auto pack = [&instances, offset](const PositionComponent& pos, const VelocityComponent& vel, const ColorComponent& color, const SizeComponent& size)
 			{
-				PROFILE_THREAD("InterpolateSizeThread");
+				instances.AddCircle(RenderPosition(pos, vel, offset), size.size.x, color.color);
+			};
 
-				auto sizeOverLifetimeView = reg.view<SizeOverLifetimeComponent, const LifetimeComponent>();
-				std::for_each(EXECUTION_POLICY, sizeOverLifetimeView.begin(), sizeOverLifetimeView.end(), [&sizeOverLifetimeView](auto entity)
-					{
-						auto [sizeOverLifeComponent, lifetimeComponent] = sizeOverLifetimeView.get<SizeOverLifetimeComponent, const LifetimeComponent>(entity);
-						Interpolate(sizeOverLifeComponent, lifetimeComponent);
-					});
-			}, std::ref(reg));
+		if (followers.Follows<CircleDrawComponent>())
+		{
+			EachPackedParticle<const PositionComponent, const VelocityComponent, const ColorComponent, const SizeComponent>(reg, pack);
+		}
+		else
+		{
+			reg.view<const PositionComponent, const VelocityComponent, const ColorComponent, const SizeComponent, const CircleDrawComponent>().each(pack);
+		}
+	}
 
-		return std::move(thread);
+	void PackEllipseSystem(ps_registry& reg, const GroupFollowers& followers, ShapeInstanceBuffer& instances, float offset)
+	{
+		PROFILE_FUNCTION();
+		METRICS_SCOPE("ecs.PackEllipseSystem");
+
+		auto pack = [&instances, offset](const PositionComponent& pos, const VelocityComponent& vel, const ColorComponent& color, const SizeComponent& size)
+			{
+				instances.AddEllipse(RenderPosition(pos, vel, offset), size.size, color.color);
+			};
+
+		if (followers.Follows<EllipseDrawComponent>())
+		{
+			EachPackedParticle<const PositionComponent, const VelocityComponent, const ColorComponent, const SizeComponent>(reg, pack);
+		}
+		else
+		{
+			reg.view<const PositionComponent, const VelocityComponent, const ColorComponent, const SizeComponent, const EllipseDrawComponent>().each(pack);
+		}
 	}
 
-	_NODISCARD std::thread InterpolateVelocitySystem(ps_registry& reg)
+	void PackRectangleSystem(ps_registry& reg, const GroupFollowers& followers, ShapeInstanceBuffer& instances, float offset)
 	{
 		PROFILE_FUNCTION();
+		METRICS_SCOPE("ecs.PackRectangleSystem");
 
-		std::thread thread([](ps_registry& reg)
+		auto pack = [&instances, offset](const PositionComponent& pos, const VelocityComponent& vel, const ColorComponent& color, const SizeComponent& size)
 			{
-				PROFILE_THREAD("InterpolateVelocityThread");
+				instances.AddRect(RenderPosition(pos, vel, offset), size.size, color.color);
+			};
+
+		if (followers.Follows<RectDrawComponent>())
+		{
+			EachPackedParticle<const PositionComponent, const VelocityComponent, const ColorComponent, const SizeComponent>(reg, pack);
+		}
+		else
+		{
+			reg.view<const PositionComponent, const VelocityComponent, const ColorComponent, const SizeComponent, const RectDrawComponent>().each(pack);
+		}
+	}
+
+	void PackRectangleGradientSystem(ps_registry& reg, const GroupFollowers& followers, ShapeInstanceBuffer& instances, float offset)
+	{
+		PROFILE_FUNCTION();
+		METRICS_SCOPE("ecs.PackRectangleGradientSystem");
 
-				auto velOverLifetimeView = reg.view<VelocityOverLifetimeComponent, const LifetimeComponent>();
-				std::for_each(EXECUTION_POLICY, velOverLifetimeView.begin(), velOverLifetimeView.end(), [&velOverLifetimeView](auto entity)
-					{
-						auto [velOverLifetimeComponent, lifetimeComponent] = velOverLifetimeView.get<VelocityOverLifetimeComponent, const LifetimeComponent>(entity);
-						Interpolate(velOverLifetimeComponent, lifetimeComponent);
-					});
-			}, std::ref(reg));
+		auto pack = [&instances, offset](const PositionComponent& pos, const VelocityComponent& vel, const ColorComponent& color, const SizeComponent& size, const RectGradientDrawComponent& gradient)
+			{
+				const Color color1 = gradient.order ? color.color : gradient.other;
+				const Color color2 = gradient.order ? gradient.other : color.color;
+				instances.AddRectGradient(RenderPosition(pos, vel, offset), size.size, color1, color2, gradient.isHorizontal);
+			};
 
-		return std::move(thread);
+		if (followers.Follows<RectGradientDrawComponent>())
+		{
+			EachPackedParticle<const PositionComponent, const VelocityComponent, const ColorComponent, const SizeComponent, const RectGradientDrawComponent>(reg, pack);
+		}
+		else
+		{
+			reg.view<const PositionComponent, const VelocityComponent, const ColorComponent, const SizeComponent, const RectGradientDrawComponent>().each(pack);
+		}
 	}
 
-	_NODISCARD std::thread InterpolateAngularVelocitySystem(ps_registry& reg)
+	void PackRoundedRectangleSystem(ps_registry& reg, const GroupFollowers& followers, ShapeInstanceBuffer& instances, float offset)
 	{
 		PROFILE_FUNCTION();
+		METRICS_SCOPE("ecs.PackRoundedRectangleSystem");
 
-		std::thread thread([](ps_registry& reg)
+		auto pack = [&instances, offset](const PositionComponent& pos, const VelocityComponent& vel, const ColorComponent& color, const SizeComponent& size, const RoundedRectDrawComponent& roundedRect)
 			{
-				PROFILE_THREAD("InterpolateAngularVelocityThread");
+				instances.AddRoundedRect(RenderPosition(pos, vel, offset), size.size, roundedRect.roundness, color.color);
+			};
+
+		if (followers.Follows<RoundedRectDrawComponent>())
+		{
+			EachPackedParticle<const PositionComponent, const VelocityComponent, const ColorComponent, const SizeComponent, const RoundedRectDrawComponent>(reg, pack);
+		}
+		else
+		{
+			reg.view<const PositionComponent, const VelocityComponent, const ColorComponent, const SizeComponent, const RoundedRectDrawComponent>().each(pack);
+		}
+	}
+
+	void PackRingSystem(ps_registry& reg, const GroupFollowers& followers, ShapeInstanceBuffer& instances, float offset)
+	{
+		PROFILE_FUNCTION();
+		METRICS_SCOPE("ecs.PackRingSystem");
 
-				auto view = reg.view<AngularVelocityOverLifetimeComponent, const LifetimeComponent>();
-				std::for_each(EXECUTION_POLICY, view.begin(), view.end(), [&view](auto entity)
-					{
-						auto [angularVelOverLifeComponent, lifetimeComponent] = view.get<AngularVelocityOverLifetimeComponent, const LifetimeComponent>(entity);
-						Interpolate(angularVelOverLifeComponent, lifetimeComponent);
-					});
-			}, std::ref(reg));
+		auto pack = [&instances, offset](const PositionComponent& pos, const VelocityComponent& vel, const ColorComponent& color, const SizeComponent& size, const RingDrawComponent& ring)
+			{
+				instances.AddRing(RenderPosition(pos, vel, offset), size.size.x, size.size.y, ring.startAngle, ring.endAngle, ring.segements, color.color);
+			};
 
-		return std::move(thread);
+		if (followers.Follows<RingDrawComponent>())
+		{
+			EachPackedParticle<const PositionComponent, const VelocityComponent, const ColorComponent, const SizeComponent, const RingDrawComponent>(reg, pack);
+		}
+		else
+		{
+			reg.view<const PositionComponent, const VelocityComponent, const ColorComponent, const SizeComponent, const RingDrawComponent>().each(pack);
+		}
 	}
 
-	void DrawPixelSystem(ps_registry& reg)
+	void DrawShapeBatchSystem(IRenderBackend& backend, const ShapeInstanceBuffer& instances)
 	{
 		PROFILE_FUNCTION();
+		METRICS_SCOPE("ecs.DrawShapeBatchSystem");
 
-		reg.view<const PositionComponent, const ColorComponent, const PixelDrawComponent>()
-			.each([](const PositionComponent& pos, const ColorComponent& color)
+		backend.DrawShapes(instances);
+	}
+
+	static constexpr std::size_t POINT_BATCH_CHUNK_SIZE = 4096;
+
+	template<typename View>
+	void FillPoints(const View& view, const ps_entity* entities, Span<PointInstance> points, float offset)
+	{
+		ParallelForChunks(points.size, POINT_BATCH_CHUNK_SIZE, [&view, &points, entities, offset](std::size_t first, std::size_t count)
+			{
+				for (std::size_t i = first; i < first + count; i++)
 				{
-					DrawPixelV(pos.position, color.color);
-				});
+					auto [pos, vel, color, size] = view.template get<const PositionComponent, const VelocityComponent, const ColorComponent, const SizeComponent>(entities [i]);
+					points [i] = { RenderPosition(pos, vel, offset), size.size.x, color.color };
+				}
+			});
 	}
 
-	void DrawCircleSystem(ps_registry& reg)
+	// Points of the particles starting at group index first, read page by page
+	void FillPackedPoints(ps_registry& reg, std::size_t first, Span<PointInstance> points, float offset)
 	{
-		PROFILE_FUNCTION();
+		const PackedStorage<const PositionComponent> positionStorage(reg);
+		const PackedStorage<const VelocityComponent> velocityStorage(reg);
+		const PackedStorage<const ColorComponent> colorStorage(reg);
+		const PackedStorage<const SizeComponent> sizeStorage(reg);
 
-		reg.view<const PositionComponent, const ColorComponent, const SizeComponent, const CircleDrawComponent>()
-			.each([](const PositionComponent& pos, const ColorComponent& color, const SizeComponent& size)
+		ParallelForPages(first, first + points.size, [&, first, offset](std::size_t begin, std::size_t count)
+			{
+				const PositionComponent* pos = positionStorage.At(begin);
+				const VelocityComponent* vel = velocityStorage.At(begin);
+				const ColorComponent* color = colorStorage.At(begin);
+				const SizeComponent* size = sizeStorage.At(begin);
+				PointInstance* out = points.data + (begin - first);
+
+				for (std::size_t i = 0; i < count; i++)
 				{
-					DrawCircleV(pos.position, size.size.x, color.color);
-				});
+					out [i] = { RenderPosition(pos [i], vel [i], offset), size [i].size.x, color [i].color };
+				}
+			});
 	}
 
-	void DrawEllipseSystem(ps_registry& reg)
+	// Points are written straight into the backend's buffer by parallel chunks,
+	// a batch is only split when it exceeds the backend capacity.
+	void DrawPointBatchSystem(ps_registry& reg, const GroupFollowers& followers, IRenderBackend& backend, float offset)
 	{
 		PROFILE_FUNCTION();
+		METRICS_SCOPE("ecs.DrawPointBatchSystem");
 
-		reg.view<const PositionComponent, const ColorComponent, const SizeComponent, const EllipseDrawComponent>()
-			.each([](const PositionComponent& pos, const ColorComponent& color, const SizeComponent& size)
-				{
-					DrawEllipse((int)pos.position.x, (int)pos.position.y, size.size.x, size.size.y, color.color);
-				});
+		auto view = reg.view<const PositionComponent, const VelocityComponent, const ColorComponent, const SizeComponent, const PointBatchDrawComponent>();
+
+		// Packed particles are read by group index, no entity list is needed
+		const bool isPacked = followers.Follows<PointBatchDrawComponent>();
+		const std::vector<ps_entity> entities = isPacked ? std::vector<ps_entity>() : std::vector<ps_entity>(view.begin(), view.end());
+		const std::size_t count = isPacked ? ParticleGroup(reg).size() : entities.size();
+
+		std::size_t written = 0;
+		while (written < count)
+		{
+			const auto points = backend.ReservePoints((uint32_t)std::min<std::size_t>(count - written, UINT32_MAX));
+			if (isPacked)
+			{
+				FillPackedPoints(reg, written, points, offset);
+			}
+			else
+			{
+				FillPoints(view, entities.data() + written, points, offset);
+			}
+			written += points.size;
+		}
+
+		backend.FlushPoints();
 	}
 
-	void DrawRectangleSystem(ps_registry& reg)
+	// Same points as DrawPointBatchSystem, kept in memory to be drawn later by SubmitPointBatchSystem
+	void PackPointBatchSystem(ps_registry& reg, const GroupFollowers& followers, std::vector<PointInstance>& points, float offset)
 	{
 		PROFILE_FUNCTION();
+		METRICS_SCOPE("ecs.PackPointBatchSystem");
 
-		reg.view<const PositionComponent, const ColorComponent, const SizeComponent, const RectDrawComponent>()
-			.each([](const PositionComponent& pos, const ColorComponent& color, const SizeComponent& size)
-				{
-					DrawRectangleV(pos.position, size.size, color.color);
-				});
+		if (followers.Follows<PointBatchDrawComponent>())
+		{
+			points.resize(ParticleGroup(reg).size());
+			FillPackedPoints(reg, 0, { points.data(), points.size() }, offset);
+			return;
+		}
+
+		auto view = reg.view<const PositionComponent, const VelocityComponent, const ColorComponent, const SizeComponent, const PointBatchDrawComponent>();
+		const std::vector<ps_entity> entities(view.begin(), view.end());
+
+		points.resize(entities.size());
+		FillPoints(view, entities.data(), { points.data(), points.size() }, offset);
 	}
 
-	void DrawPointBatchSystem(ps_registry& reg, PointBatchRenderer& pointBatchRenderer)
+	// The points are kept, a frame without a new pack submits them again
+	void SubmitPointBatchSystem(IRenderBackend& backend, const std::vector<PointInstance>& points)
 	{
 		PROFILE_FUNCTION();
+		METRICS_SCOPE("ecs.SubmitPointBatchSystem");
 
-		reg.view<const PositionComponent, const ColorComponent, const SizeComponent, const PointBatchDrawComponent>()
-			.each([&pointBatchRenderer](const PositionComponent& pos, const ColorComponent& color, const SizeComponent& size)
-				{
-					pointBatchRenderer.Add(pos.position, size.size.x, color.color);
-				});
-		pointBatchRenderer.Draw();
+		std::size_t written = 0;
+		while (written < points.size())
+		{
+			const auto reserved = backend.ReservePoints((uint32_t)std::min<std::size_t>(points.size() - written, UINT32_MAX));
+			std::copy_n(points.data() + written, reserved.size, reserved.data);
+			written += reserved.size;
+		}
+
+		backend.FlushPoints();
 	}
 }
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "common.hpp"
+#include "instrumentation.hpp"
+#include "threadpool.hpp"
+
+// Overlaps the simulation of the next frame with drawing the current one. The
+// simulation runs on a dedicated thread and writes everything the renderer needs
+// into the back snapshot, while the main thread draws the front snapshot. Outside
+// of Begin / Wait the simulation state belongs to the main thread again.
+template<typename Snapshot>
+class FramePipeline
+{
+	ThreadPool thread;
+	Snapshot snapshots[2];
+	uint32_t front;
+
+	std::mutex mutex;
+	std::condition_variable finished;
+	bool isBusy;
+
+	// Non copyable & moveable
+	FramePipeline(const FramePipeline&) = delete;
+	FramePipeline& operator=(const FramePipeline&) = delete;
+
+public:
+	FramePipeline() :
+		thread(1),
+		front(0),
+		isBusy(false)
+	{
+	}
+
+	~FramePipeline()
+	{
+		Wait();
+	}
+
+	// Snapshot of the last finished frame, drawn by the main thread
+	Snapshot& Front() { return snapshots [front]; }
+
+	// Snapshot written by the frame being simulated
+	Snapshot& Back() { return snapshots [1 - front]; }
+
+	// Publishes the last simulated frame and runs simulate for the next one, which should fill Back()
+	void Begin(std::function<void()> simulate)
+	{
+		Wait();
+
+		front = 1 - front;
+		{
+			std::lock_guard lock(mutex);
+			isBusy = true;
+		}
+
+		thread.Submit([this, simulate = std::move(simulate)]
+			{
+				simulate();
+				{
+					std::lock_guard lock(mutex);
+					isBusy = false;
+				}
+				finished.notify_all();
+			});
+	}
+
+	// Blocks until the frame being simulated is done
+	void Wait()
+	{
+		PROFILE_FUNCTION();
+
+		std::unique_lock lock(mutex);
+		finished.wait(lock, [this] { return !isBusy; });
+	}
+};
\ No newline at end of file
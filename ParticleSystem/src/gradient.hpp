@@ -1,11 +1,122 @@
 #pragma once
 
 #include <vector>
+#include <mutex>
 #include <raylib.h>
 #include <raymath.h>
 
+#include "common.hpp"
 #include "interpolator.hpp"
 
+// Interpolates the color in HSV space and the alpha linearly
+Color LerpHSV(Color color1, Color color2, float t)
+{
+	Vector3 hsv1 = ColorToHSV(color1);
+	Vector3 hsv2 = ColorToHSV(color2);
+	Vector3 hsv = Vector3Lerp(hsv1, hsv2, t);
+	return ColorAlpha(ColorFromHSV(hsv.x, hsv.y, hsv.z), Lerp(color1.a / 255.0f, color2.a / 255.0f, t));
+}
+
+// Gradient sampled once into a fixed resolution RGBA table,
+// evaluating it is a lookup and a lerp between the two nearest entries.
+class BakedGradient
+{
+public:
+	static constexpr int Resolution = 256;
+
+private:
+	Color table[Resolution];
+
+public:
+	template<typename Function>
+	explicit BakedGradient(Function evaluate)
+	{
+		for (int i = 0; i < Resolution; i++)
+		{
+			table[i] = evaluate(i / (float)(Resolution - 1));
+		}
+	}
+
+	Color Evaluate(float t) const
+	{
+		const float x = Clamp01(t) * (Resolution - 1);
+		const int index1 = (int)x;
+		const int index2 = std::min(index1 + 1, Resolution - 1);
+		const float f = x - index1;
+
+		const Color& a = table[index1];
+		const Color& b = table[index2];
+
+		return Color{
+			(unsigned char)(a.r + (b.r - a.r) * f + 0.5f),
+			(unsigned char)(a.g + (b.g - a.g) * f + 0.5f),
+			(unsigned char)(a.b + (b.b - a.b) * f + 0.5f),
+			(unsigned char)(a.a + (b.a - a.a) * f + 0.5f)
+		};
+	}
+
+	void Evaluate(const float* t, Color* out, std::size_t count) const
+	{
+		for (std::size_t i = 0; i < count; i++)
+		{
+			out [i] = Evaluate(t [i]);
+		}
+	}
+
+	// Returns a table shared by every gradient with the same keys. Interned tables
+	// live as long as the program, so they can be referenced by plain pointer from
+	// components that are copied per particle.
+	template<typename KeyValue>
+	static const BakedGradient* Intern(const KeyValue* keyValues, int length)
+	{
+		static std::mutex mutex;
+		static std::vector<std::pair<std::vector<std::pair<float, Color>>, Scoped<BakedGradient>>> tables;
+
+		std::vector<std::pair<float, Color>> keys;
+		for (int i = 0; i < length; i++)
+		{
+			keys.emplace_back(keyValues[i].key, keyValues[i].value);
+		}
+
+		std::lock_guard lock(mutex);
+		for (const auto& table : tables)
+		{
+			const auto& other = table.first;
+			const bool isEqual = other.size() == keys.size() && std::equal(keys.begin(), keys.end(), other.begin(), [] (const auto& a, const auto& b)
+				{
+					return a.first == b.first &&
+						a.second.r == b.second.r && a.second.g == b.second.g && a.second.b == b.second.b && a.second.a == b.second.a;
+				});
+			if (isEqual) return table.second.get();
+		}
+
+		// Like the interpolators, a gradient without keys evaluates to PINK everywhere
+		auto baked = MakeScoped<BakedGradient>([&keys] (float t)
+			{
+				if (keys.empty()) return PINK;
+
+				std::size_t index1 = 0;
+				std::size_t index2 = keys.size() > 1 ? 1 : 0;
+				for (std::size_t i = 0; i + 1 < keys.size(); i++)
+				{
+					if (t >= keys[i].first && t <= keys[i + 1].first)
+					{
+						index1 = i;
+						index2 = i + 1;
+						break;
+					}
+				}
+
+				const float range = keys[index2].first - keys[index1].first;
+				const float f = range > 0.0f ? (t - keys[index1].first) / range : 0.0f;
+				return LerpHSV(keys[index1].second, keys[index2].second, f);
+			});
+
+		tables.emplace_back(std::move(keys), std::move(baked));
+		return tables.back().second.get();
+	}
+};
+
 namespace naive
 {
 	class Gradient
@@ -22,12 +133,30 @@ namespace naive
 
 	private:
 		std::vector<KeyColor> colors;
+		Ref<const BakedGradient> baked;
+		bool isBaked = true;
 
 	public:
 		Gradient() = default;
-		Gradient(const std::initializer_list<KeyColor>& colors) : colors(colors) {}
-		void Add(const KeyColor keyColor) { colors.push_back(keyColor); }
+		Gradient(const std::initializer_list<KeyColor>& colors) : colors(colors) { Bake(); }
+		void Add(const KeyColor keyColor) { colors.push_back(keyColor); Bake(); }
+
+		// Baked gradients evaluate from a lookup table instead of converting to HSV per call
+		void SetBaked(bool isBaked) { this->isBaked = isBaked; Bake(); }
+
 		Color Evaluate(float t)
+		{
+			if (baked) return baked->Evaluate(t);
+			return EvaluateKeys(t);
+		}
+
+	private:
+		void Bake()
+		{
+			baked = isBaked && colors.size() > 1 ? MakeRef<BakedGradient>([this] (float t) { return EvaluateKeys(t); }) : nullptr;
+		}
+
+		Color EvaluateKeys(float t)
 		{
 			if (colors.size() < 1) return PINK;
 			if (colors.size() < 2) return colors [0].color;
@@ -36,7 +165,7 @@ namespace naive
 			int index2 = 0;
 			for (int i = 0; i < colors.size() - 1; i++)
 			{
-				if (t >= colors [i].key && t < colors [i + 1].key)
+				if (t >= colors [i].key && t <= colors [i + 1].key)
 				{
 					index1 = i;
 					index2 = i + 1;
@@ -44,13 +173,8 @@ namespace naive
 				}
 			}
 
-			Vector3 hsv1 = ColorToHSV(colors [index1].color);
-			Vector3 hsv2 = ColorToHSV(colors [index2].color);
-			float a1 = colors [index1].color.a;
-			float a2 = colors [index2].color.a;
 			t = (t - colors [index1].key) / (colors [index2].key - colors [index1].key);
-			Vector3 hsv = Vector3Lerp(hsv1, hsv2, t);
-			return ColorAlpha(ColorFromHSV(hsv.x, hsv.y, hsv.z), Lerp(a1 / 255, a2 / 255, t));
+			return LerpHSV(colors [index1].color, colors [index2].color, t);
 		}
 	};
 }
@@ -59,16 +183,44 @@ namespace advanced
 {
 	class Gradient : public AInterpolator<Color>
 	{
+		Ref<const BakedGradient> baked;
+		bool isBaked = true;
+
 	public:
-		Gradient(const std::initializer_list<KeyValue>& keyvalues) : AInterpolator(keyvalues) {}
+		Gradient(const std::initializer_list<KeyValue>& keyvalues) : AInterpolator(keyvalues) { Bake(); }
+
+		// Baked gradients evaluate from a lookup table instead of converting to HSV per call
+		void SetBaked(bool isBaked) { this->isBaked = isBaked; Bake(); }
+
+		const Color Evaluate(float t) const
+		{
+			if (baked) return baked->Evaluate(t);
+			return AInterpolator::Evaluate(t);
+		}
+
+		void Evaluate(const float* t, Color* out, std::size_t count) const
+		{
+			if (baked)
+			{
+				baked->Evaluate(t, out, count);
+				return;
+			}
+
+			for (std::size_t i = 0; i < count; i++)
+			{
+				out [i] = AInterpolator::Evaluate(t [i]);
+			}
+		}
+
 	protected:
 		Color Default() const { return PINK; }
-		Color Interpolate(Color index1, Color index2, float t) const
+		Color Interpolate(Color index1, Color index2, float t) const { return LerpHSV(index1, index2, t); }
+		void OnKeysChanged() override { Bake(); }
+
+	private:
+		void Bake()
 		{
-			Vector3 hsv1 = ColorToHSV(index1);
-			Vector3 hsv2 = ColorToHSV(index2);
-			Vector3 hsv = Vector3Lerp(hsv1, hsv2, t);
-			return ColorAlpha(ColorFromHSV(hsv.x, hsv.y, hsv.z), Lerp(index1.a / 255.0f, index2.a / 255.0f, t));
+			baked = isBaked && keyValues.size() > 1 ? MakeRef<BakedGradient>([this] (float t) { return AInterpolator::Evaluate(t); }) : nullptr;
 		}
 	};
 }
\ No newline at end of file
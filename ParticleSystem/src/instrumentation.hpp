@@ -6,31 +6,106 @@
 // Changes //
 // + Removed Hazel namespace
 // + Removed HZ_ preprendix from profiling macros
+// + Scopes record binary events into per thread lock free rings, a writer thread serializes them
+// + Sessions are opened at runtime, closed sessions cost scopes a single branch
+// + Sampled scopes, counter events and frame markers
 
-// Enable or Disable Profiling
-#define PROFILE 0
+// Compile profiling in or out, when compiled in it is still off until a session is begun
+#define PROFILE 1
 #define PROFILE_THREADS 1
 
 #include "common.hpp"
 
 #include <algorithm>
+#include <charconv>
 #include <chrono>
+#include <condition_variable>
+#include <cstdlib>
 #include <fstream>
-#include <iomanip>
 #include <string>
 #include <thread>
 #include <mutex>
-#include <sstream>
 
-using FloatingPointMicroseconds = std::chrono::duration<double, std::micro>;
+enum class ProfileEventType : uint32_t
+{
+	Complete,
+	Counter,
+	Frame
+};
 
-struct ProfileResult
+// Binary event recorded by a scope. Names are interned: they point at static
+// storage, so the writer thread can format them long after the scope is gone.
+// Value is the end of a complete event, the value of a counter or the frame index.
+struct ProfileEvent
 {
-	std::string Name;
+	const char* Name;
+	int64_t Start;
+	int64_t Value;
+	ProfileEventType Type;
+	uint32_t SampleRate;
+};
+
+// Single producer, single consumer ring owned by one profiled thread. Only that
+// thread writes m_Head and only the writer thread writes m_Tail, so recording an
+// event takes no lock. A full ring drops the event rather than stalling the thread.
+class ProfileEventBuffer
+{
+public:
+	static constexpr uint32_t Capacity = 1 << 14;
+
+	ProfileEventBuffer(uint32_t threadID)
+		: m_ThreadID(threadID), m_Head(0), m_Tail(0), m_Dropped(0), m_IsOrphaned(false)
+	{
+	}
+
+	uint32_t GetThreadID() const { return m_ThreadID; }
+	uint64_t GetDropped() const { return m_Dropped.load(std::memory_order_relaxed); }
+
+	bool IsEmpty() const { return m_Head.load(std::memory_order_acquire) == m_Tail.load(std::memory_order_relaxed); }
+
+	// Set once the owning thread exits, the buffer is released after its last drain
+	bool IsOrphaned() const { return m_IsOrphaned.load(std::memory_order_acquire); }
+	void SetOrphaned() { m_IsOrphaned.store(true, std::memory_order_release); }
+
+	// Producer side
+	void Push(const ProfileEvent& event)
+	{
+		const auto head = m_Head.load(std::memory_order_relaxed);
+		if (head - m_Tail.load(std::memory_order_acquire) == Capacity)
+		{
+			m_Dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		m_Events[head & (Capacity - 1)] = event;
+		m_Head.store(head + 1, std::memory_order_release);
+	}
+
+	// Consumer side, calls function for every pending event in recording order
+	template<typename Function>
+	void Drain(Function function)
+	{
+		const auto tail = m_Tail.load(std::memory_order_relaxed);
+		const auto head = m_Head.load(std::memory_order_acquire);
+		for (auto i = tail; i != head; i++)
+			function(m_Events[i & (Capacity - 1)]);
+		m_Tail.store(head, std::memory_order_release);
+	}
 
-	FloatingPointMicroseconds Start;
-	std::chrono::microseconds ElapsedTime;
-	std::thread::id ThreadID;
+	// Consumer side, forgets pending events
+	void Discard()
+	{
+		m_Tail.store(m_Head.load(std::memory_order_acquire), std::memory_order_release);
+	}
+private:
+	ProfileEvent m_Events[Capacity];
+	uint32_t m_ThreadID;
+
+	// Kept on separate cache lines so the producer and the writer do not false share
+	alignas(64) std::atomic<uint32_t> m_Head;
+	alignas(64) std::atomic<uint32_t> m_Tail;
+	std::atomic<uint64_t> m_Dropped;
+	std::atomic<bool> m_IsOrphaned;
 };
 
 struct InstrumentationSession
@@ -53,7 +128,7 @@ public:
 			// Subsequent profiling output meant for the original session will end up in the
 			// newly opened session instead.  That's better than having badly formatted
 			// profiling output.
-			ErrorLog("Instrumentor::BeginSession('{0}') when session '{1}' already open.", name, m_CurrentSession->Name);
+			ErrorLog("Instrumentor::BeginSession('%s') when session '%s' already open.", name.c_str(), m_CurrentSession->Name.c_str());
 			InternalEndSession();
 		}
 
@@ -63,10 +138,21 @@ public:
 		{
 			m_CurrentSession = new InstrumentationSession({ name });
 			WriteHeader();
+
+			// Events recorded while no session was open belong to nobody
+			{
+				std::lock_guard buffersLock(m_BuffersMutex);
+				for (auto& buffer : m_Buffers)
+					buffer->Discard();
+			}
+
+			m_IsWriting = true;
+			m_Writer = std::thread([this] { WriterLoop(); });
+			s_IsActive.store(true, std::memory_order_release);
 		}
 		else
 		{
-			ErrorLog("Instrumentor could not open results file '{0}'.", filepath);
+			ErrorLog("Instrumentor could not open results file '%s'.", filepath.c_str());
 		}
 	}
 
@@ -76,27 +162,43 @@ public:
 		InternalEndSession();
 	}
 
-	void WriteProfile(const ProfileResult& result)
+	bool IsSessionOpen()
 	{
-		std::stringstream json;
+		std::lock_guard lock(m_Mutex);
+		return m_CurrentSession != nullptr;
+	}
 
-		json << std::setprecision(3) << std::fixed;
-		json << ",{";
-		json << "\"cat\":\"function\",";
-		json << "\"dur\":" << (result.ElapsedTime.count()) << ',';
-		json << "\"name\":\"" << result.Name << "\",";
-		json << "\"ph\":\"X\",";
-		json << "\"pid\":0,";
-		json << "\"tid\":" << result.ThreadID << ",";
-		json << "\"ts\":" << result.Start.count();
-		json << "}";
+	// Whether a session is recording, this is the only check a scope makes while profiling is off
+	static bool IsActive() { return s_IsActive.load(std::memory_order_relaxed); }
 
-		std::lock_guard lock(m_Mutex);
-		if (m_CurrentSession)
-		{
-			m_OutputStream << json.str();
-			m_OutputStream.flush();
-		}
+	// Lock free, only touches the calling thread's buffer
+	void Record(const ProfileEvent& event)
+	{
+		GetThreadBuffer().Push(event);
+	}
+
+	void RecordCounter(const char* name, int64_t value)
+	{
+		Record({ name, Now(), value, ProfileEventType::Counter, 1 });
+	}
+
+	// Marks the start of a new frame, called from the thread driving the frames
+	void MarkFrame()
+	{
+		Record({ "Frame", Now(), m_FrameIndex++, ProfileEventType::Frame, 1 });
+	}
+
+	// Set to anything but 0 to begin profiling at startup
+	static bool IsRequestedByEnvironment(const char* variable = "PARTICLES_PROFILE")
+	{
+		const char* value = std::getenv(variable);
+		return value && *value && std::string(value) != "0";
+	}
+
+	// Timestamp of the event clock in nanoseconds
+	static int64_t Now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
 	}
 
 	static Instrumentor& Get()
@@ -105,9 +207,19 @@ public:
 		return instance;
 	}
 private:
+	// Registers the thread's buffer on first use and orphans it when the thread exits
+	struct ThreadBuffer
+	{
+		std::shared_ptr<ProfileEventBuffer> Buffer;
+
+		ThreadBuffer() : Buffer(Instrumentor::Get().RegisterThread()) {}
+		~ThreadBuffer() { Buffer->SetOrphaned(); }
+	};
+
 	Instrumentor()
-		: m_CurrentSession(nullptr)
+		: m_CurrentSession(nullptr), m_IsWriting(false), m_NextThreadID(0), m_FrameIndex(0)
 	{
+		m_Chunk.reserve(ChunkSize * 2);
 	}
 
 	~Instrumentor()
@@ -115,10 +227,23 @@ private:
 		EndSession();
 	}
 
+	static ProfileEventBuffer& GetThreadBuffer()
+	{
+		thread_local ThreadBuffer threadBuffer;
+		return *threadBuffer.Buffer;
+	}
+
+	std::shared_ptr<ProfileEventBuffer> RegisterThread()
+	{
+		std::lock_guard lock(m_BuffersMutex);
+		auto buffer = std::make_shared<ProfileEventBuffer>(m_NextThreadID++);
+		m_Buffers.push_back(buffer);
+		return buffer;
+	}
+
 	void WriteHeader()
 	{
 		m_OutputStream << "{\"otherData\": {},\"traceEvents\":[{}";
-		m_OutputStream.flush();
 	}
 
 	void WriteFooter()
@@ -127,12 +252,133 @@ private:
 		m_OutputStream.flush();
 	}
 
+	void WriterLoop()
+	{
+		std::unique_lock lock(m_WriterMutex);
+		while (m_IsWriting)
+		{
+			m_WriterCondition.wait_for(lock, std::chrono::milliseconds(2));
+			lock.unlock();
+			Drain();
+			lock.lock();
+		}
+	}
+
+	// Serializes every pending event, only ever run by one thread at a time
+	void Drain()
+	{
+		std::lock_guard lock(m_BuffersMutex);
+		for (auto& buffer : m_Buffers)
+		{
+			const auto threadID = buffer->GetThreadID();
+			buffer->Drain([this, threadID](const ProfileEvent& event)
+				{
+					switch (event.Type)
+					{
+					case ProfileEventType::Complete:
+						m_Chunk += ",{\"cat\":\"function\",\"dur\":";
+						AppendMicroseconds(event.Value - event.Start);
+						m_Chunk += ",\"name\":\"";
+						m_Chunk += event.Name;
+						m_Chunk += "\",\"ph\":\"X\"";
+						if (event.SampleRate > 1)
+						{
+							m_Chunk += ",\"args\":{\"sampleRate\":";
+							AppendInteger(event.SampleRate);
+							m_Chunk += '}';
+						}
+						break;
+					case ProfileEventType::Counter:
+						m_Chunk += ",{\"cat\":\"counter\",\"name\":\"";
+						m_Chunk += event.Name;
+						m_Chunk += "\",\"ph\":\"C\",\"args\":{\"value\":";
+						AppendInteger(event.Value);
+						m_Chunk += '}';
+						break;
+					case ProfileEventType::Frame:
+						m_Chunk += ",{\"cat\":\"frame\",\"name\":\"";
+						m_Chunk += event.Name;
+						m_Chunk += "\",\"ph\":\"i\",\"s\":\"g\",\"args\":{\"frame\":";
+						AppendInteger(event.Value);
+						m_Chunk += '}';
+						break;
+					}
+
+					m_Chunk += ",\"pid\":0,\"tid\":";
+					AppendInteger(threadID);
+					m_Chunk += ",\"ts\":";
+					AppendMicroseconds(event.Start);
+					m_Chunk += '}';
+
+					if (m_Chunk.size() >= ChunkSize)
+						FlushChunk();
+				});
+		}
+		FlushChunk();
+
+		m_Buffers.erase(std::remove_if(m_Buffers.begin(), m_Buffers.end(), [this](const auto& buffer)
+			{
+				if (!buffer->IsOrphaned() || !buffer->IsEmpty()) return false;
+				m_Dropped += buffer->GetDropped();
+				return true;
+			}), m_Buffers.end());
+	}
+
+	void AppendInteger(int64_t value)
+	{
+		char digits[24];
+		const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+		m_Chunk.append(digits, result.ptr);
+	}
+
+	// Nanoseconds as microseconds with three decimals, without going through floating point
+	void AppendMicroseconds(int64_t nanoseconds)
+	{
+		if (nanoseconds < 0)
+		{
+			m_Chunk += '-';
+			nanoseconds = -nanoseconds;
+		}
+		AppendInteger(nanoseconds / 1000);
+
+		const auto fraction = nanoseconds % 1000;
+		const char decimals[] = { '.', char('0' + fraction / 100), char('0' + fraction / 10 % 10), char('0' + fraction % 10) };
+		m_Chunk.append(decimals, sizeof(decimals));
+	}
+
+	void FlushChunk()
+	{
+		m_OutputStream.write(m_Chunk.data(), m_Chunk.size());
+		m_Chunk.clear();
+	}
+
 	// Note: you must already own lock on m_Mutex before
 	// calling InternalEndSession()
 	void InternalEndSession()
 	{
 		if (m_CurrentSession)
 		{
+			s_IsActive.store(false, std::memory_order_release);
+			{
+				std::lock_guard lock(m_WriterMutex);
+				m_IsWriting = false;
+			}
+			m_WriterCondition.notify_all();
+			m_Writer.join();
+
+			Drain();
+
+			uint64_t dropped = m_Dropped;
+			{
+				std::lock_guard lock(m_BuffersMutex);
+				for (auto& buffer : m_Buffers)
+					dropped += buffer->GetDropped();
+			}
+			if (dropped > m_ReportedDropped)
+				WarnLog("Instrumentor dropped %llu events in session '%s', the writer could not keep up.",
+					(unsigned long long)(dropped - m_ReportedDropped), m_CurrentSession->Name.c_str());
+			m_ReportedDropped = dropped;
+
 			WriteFooter();
 			m_OutputStream.close();
 			delete m_CurrentSession;
@@ -140,18 +386,34 @@ private:
 		}
 	}
 private:
+	static constexpr std::size_t ChunkSize = 1 << 16;
+
 	std::mutex m_Mutex;
 	InstrumentationSession* m_CurrentSession;
 	std::ofstream m_OutputStream;
+	static inline std::atomic<bool> s_IsActive = false;
+
+	std::thread m_Writer;
+	std::mutex m_WriterMutex;
+	std::condition_variable m_WriterCondition;
+	bool m_IsWriting;
+	std::string m_Chunk;
+
+	std::mutex m_BuffersMutex;
+	std::vector<std::shared_ptr<ProfileEventBuffer>> m_Buffers;
+	uint32_t m_NextThreadID;
+	uint64_t m_Dropped = 0;
+	uint64_t m_ReportedDropped = 0;
+	int64_t m_FrameIndex;
 };
 
 class InstrumentationTimer
 {
 public:
-	InstrumentationTimer(const char* name)
-		: m_Name(name), m_Stopped(false)
+	// name must outlive the session, the macros hand in static strings
+	InstrumentationTimer(const char* name, bool isRecording = Instrumentor::IsActive(), uint32_t sampleRate = 1)
+		: m_Name(name), m_Start(isRecording ? Instrumentor::Now() : 0), m_SampleRate(sampleRate), m_Stopped(!isRecording)
 	{
-		m_StartTimepoint = std::chrono::steady_clock::now();
 	}
 
 	~InstrumentationTimer()
@@ -162,17 +424,17 @@ public:
 
 	void Stop()
 	{
-		auto endTimepoint = std::chrono::steady_clock::now();
-		auto highResStart = FloatingPointMicroseconds{ m_StartTimepoint.time_since_epoch() };
-		auto elapsedTime = std::chrono::time_point_cast<std::chrono::microseconds>(endTimepoint).time_since_epoch() - std::chrono::time_point_cast<std::chrono::microseconds>(m_StartTimepoint).time_since_epoch();
-
-		Instrumentor::Get().WriteProfile({ m_Name, highResStart, elapsedTime, std::this_thread::get_id() });
+		// The session may have ended while the scope ran
+		const auto end = Instrumentor::Now();
+		if (Instrumentor::IsActive())
+			Instrumentor::Get().Record({ m_Name, m_Start, end, ProfileEventType::Complete, m_SampleRate });
 
 		m_Stopped = true;
 	}
 private:
 	const char* m_Name;
-	std::chrono::time_point<std::chrono::steady_clock> m_StartTimepoint;
+	int64_t m_Start;
+	uint32_t m_SampleRate;
 	bool m_Stopped;
 };
 
@@ -203,6 +465,12 @@ namespace InstrumentorUtils {
 		}
 		return result;
 	}
+
+	// True once every rate calls, counters are per thread and per call site
+	inline bool Sample(uint32_t& counter, uint32_t rate)
+	{
+		return rate <= 1 || counter++ % rate == 0;
+	}
 }
 
 #if PROFILE
@@ -229,12 +497,24 @@ namespace InstrumentorUtils {
 
 #define PROFILE_BEGIN_SESSION(name, filepath) ::Instrumentor::Get().BeginSession(name, filepath)
 #define PROFILE_END_SESSION() ::Instrumentor::Get().EndSession()
-#define PROFILE_SCOPE_LINE2(name, line) constexpr auto fixedName##line = ::InstrumentorUtils::CleanupOutputString(name, "__cdecl ");\
+#define PROFILE_SCOPE_LINE2(name, line) static constexpr auto fixedName##line = ::InstrumentorUtils::CleanupOutputString(name, "__cdecl ");\
 											   ::InstrumentationTimer timer##line(fixedName##line.Data)
 #define PROFILE_SCOPE_LINE(name, line) PROFILE_SCOPE_LINE2(name, line)
 #define PROFILE_SCOPE(name) PROFILE_SCOPE_LINE(name, __LINE__)
 #define PROFILE_FUNCTION() PROFILE_SCOPE(FUNC_SIG)
 
+// Records one in every rate executions of the scope, for scopes too hot to trace every time
+#define PROFILE_SCOPE_SAMPLED_LINE2(name, rate, line) static constexpr auto fixedName##line = ::InstrumentorUtils::CleanupOutputString(name, "__cdecl ");\
+													  static thread_local uint32_t sampleCounter##line = 0;\
+													  ::InstrumentationTimer timer##line(fixedName##line.Data, ::Instrumentor::IsActive() && ::InstrumentorUtils::Sample(sampleCounter##line, rate), rate)
+#define PROFILE_SCOPE_SAMPLED_LINE(name, rate, line) PROFILE_SCOPE_SAMPLED_LINE2(name, rate, line)
+#define PROFILE_SCOPE_SAMPLED(name, rate) PROFILE_SCOPE_SAMPLED_LINE(name, rate, __LINE__)
+#define PROFILE_FUNCTION_SAMPLED(rate) PROFILE_SCOPE_SAMPLED(FUNC_SIG, rate)
+
+// Value is only evaluated while a session is recording
+#define PROFILE_COUNTER(name, value) do { if (::Instrumentor::IsActive()) ::Instrumentor::Get().RecordCounter(name, (int64_t)(value)); } while (0)
+#define PROFILE_FRAME_MARK() do { if (::Instrumentor::IsActive()) ::Instrumentor::Get().MarkFrame(); } while (0)
+
 #if PROFILE_THREADS
 #define STRINGIFY(x) #x
 #define PROFILE_THREAD(name) PROFILE_SCOPE(name)
@@ -247,5 +527,9 @@ namespace InstrumentorUtils {
 #define PROFILE_END_SESSION()
 #define PROFILE_SCOPE(name)
 #define PROFILE_FUNCTION()
+#define PROFILE_SCOPE_SAMPLED(name, rate)
+#define PROFILE_FUNCTION_SAMPLED(rate)
+#define PROFILE_COUNTER(name, value)
+#define PROFILE_FRAME_MARK()
 #define PROFILE_THREAD(name)
 #endif
\ No newline at end of file
@@ -0,0 +1,303 @@
+#pragma once
+
+#include "common.hpp"
+
+// Vectorized kinematic integration over contiguous Vector2 arrays.
+// Positions, velocities and accelerations are treated as flat float streams,
+// so SSE integrates 2 particles and AVX2 4 particles per instruction.
+// The widest instruction set supported by the CPU is selected at runtime.
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define KINEMATICS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#else
+#define KINEMATICS_X86 0
+#endif
+
+// MSVC allows AVX intrinsics in any function, GCC and Clang need them enabled per function
+#if KINEMATICS_X86 && (defined(__GNUC__) || defined(__clang__))
+#define KINEMATICS_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define KINEMATICS_TARGET_AVX2
+#endif
+
+namespace kinematics
+{
+	enum class InstructionSet
+	{
+		SCALAR, SSE, AVX2
+	};
+
+	const char* Stringify(InstructionSet instructionSet)
+	{
+		switch (instructionSet)
+		{
+		case InstructionSet::AVX2: return "AVX2";
+		case InstructionSet::SSE: return "SSE";
+		default: return "Scalar";
+		}
+	}
+
+	// Scalar //
+
+	// v += a * dt
+	// p += v * dt + 0.5 * a * dt^2
+	void IntegrateScalar(Vector2* positions, Vector2* velocities, const Vector2* accelerations, std::size_t count, float dt)
+	{
+		const float halfDt2 = 0.5f * dt * dt;
+
+		for (std::size_t i = 0; i < count; i++)
+		{
+			velocities [i].x += accelerations [i].x * dt;
+			velocities [i].y += accelerations [i].y * dt;
+
+			positions [i].x += velocities [i].x * dt + accelerations [i].x * halfDt2;
+			positions [i].y += velocities [i].y * dt + accelerations [i].y * halfDt2;
+		}
+	}
+
+	void IntegrateScalar(Vector2* positions, Vector2* velocities, Vector2 acceleration, std::size_t count, float dt)
+	{
+		const Vector2 deltaVelocity = { acceleration.x * dt, acceleration.y * dt };
+		const Vector2 deltaPosition = { acceleration.x * 0.5f * dt * dt, acceleration.y * 0.5f * dt * dt };
+
+		for (std::size_t i = 0; i < count; i++)
+		{
+			velocities [i].x += deltaVelocity.x;
+			velocities [i].y += deltaVelocity.y;
+
+			positions [i].x += velocities [i].x * dt + deltaPosition.x;
+			positions [i].y += velocities [i].y * dt + deltaPosition.y;
+		}
+	}
+
+	// p += v * dt
+	void AdvanceScalar(Vector2* positions, const Vector2* velocities, std::size_t count, float dt)
+	{
+		for (std::size_t i = 0; i < count; i++)
+		{
+			positions [i].x += velocities [i].x * dt;
+			positions [i].y += velocities [i].y * dt;
+		}
+	}
+
+#if KINEMATICS_X86
+	// SSE //
+
+	void IntegrateSSE(Vector2* positions, Vector2* velocities, const Vector2* accelerations, std::size_t count, float dt)
+	{
+		float* p = &positions->x;
+		float* v = &velocities->x;
+		const float* a = &accelerations->x;
+
+		const __m128 vdt = _mm_set1_ps(dt);
+		const __m128 vhalfDt2 = _mm_set1_ps(0.5f * dt * dt);
+
+		const std::size_t floats = count * 2;
+		std::size_t i = 0;
+		for (; i + 4 <= floats; i += 4)
+		{
+			const __m128 acceleration = _mm_loadu_ps(a + i);
+			const __m128 velocity = _mm_add_ps(_mm_loadu_ps(v + i), _mm_mul_ps(acceleration, vdt));
+			_mm_storeu_ps(v + i, velocity);
+
+			const __m128 delta = _mm_add_ps(_mm_mul_ps(velocity, vdt), _mm_mul_ps(acceleration, vhalfDt2));
+			_mm_storeu_ps(p + i, _mm_add_ps(_mm_loadu_ps(p + i), delta));
+		}
+
+		IntegrateScalar(positions + i / 2, velocities + i / 2, accelerations + i / 2, count - i / 2, dt);
+	}
+
+	void IntegrateSSE(Vector2* positions, Vector2* velocities, Vector2 acceleration, std::size_t count, float dt)
+	{
+		float* p = &positions->x;
+		float* v = &velocities->x;
+
+		const float halfDt2 = 0.5f * dt * dt;
+		const __m128 vdt = _mm_set1_ps(dt);
+		const __m128 deltaVelocity = _mm_setr_ps(acceleration.x * dt, acceleration.y * dt, acceleration.x * dt, acceleration.y * dt);
+		const __m128 deltaPosition = _mm_setr_ps(acceleration.x * halfDt2, acceleration.y * halfDt2, acceleration.x * halfDt2, acceleration.y * halfDt2);
+
+		const std::size_t floats = count * 2;
+		std::size_t i = 0;
+		for (; i + 4 <= floats; i += 4)
+		{
+			const __m128 velocity = _mm_add_ps(_mm_loadu_ps(v + i), deltaVelocity);
+			_mm_storeu_ps(v + i, velocity);
+
+			const __m128 delta = _mm_add_ps(_mm_mul_ps(velocity, vdt), deltaPosition);
+			_mm_storeu_ps(p + i, _mm_add_ps(_mm_loadu_ps(p + i), delta));
+		}
+
+		IntegrateScalar(positions + i / 2, velocities + i / 2, acceleration, count - i / 2, dt);
+	}
+
+	void AdvanceSSE(Vector2* positions, const Vector2* velocities, std::size_t count, float dt)
+	{
+		float* p = &positions->x;
+		const float* v = &velocities->x;
+
+		const __m128 vdt = _mm_set1_ps(dt);
+
+		const std::size_t floats = count * 2;
+		std::size_t i = 0;
+		for (; i + 4 <= floats; i += 4)
+		{
+			_mm_storeu_ps(p + i, _mm_add_ps(_mm_loadu_ps(p + i), _mm_mul_ps(_mm_loadu_ps(v + i), vdt)));
+		}
+
+		AdvanceScalar(positions + i / 2, velocities + i / 2, count - i / 2, dt);
+	}
+
+	// AVX2 //
+
+	KINEMATICS_TARGET_AVX2
+	void IntegrateAVX2(Vector2* positions, Vector2* velocities, const Vector2* accelerations, std::size_t count, float dt)
+	{
+		float* p = &positions->x;
+		float* v = &velocities->x;
+		const float* a = &accelerations->x;
+
+		const __m256 vdt = _mm256_set1_ps(dt);
+		const __m256 vhalfDt2 = _mm256_set1_ps(0.5f * dt * dt);
+
+		const std::size_t floats = count * 2;
+		std::size_t i = 0;
+		for (; i + 8 <= floats; i += 8)
+		{
+			const __m256 acceleration = _mm256_loadu_ps(a + i);
+			const __m256 velocity = _mm256_add_ps(_mm256_loadu_ps(v + i), _mm256_mul_ps(acceleration, vdt));
+			_mm256_storeu_ps(v + i, velocity);
+
+			const __m256 delta = _mm256_add_ps(_mm256_mul_ps(velocity, vdt), _mm256_mul_ps(acceleration, vhalfDt2));
+			_mm256_storeu_ps(p + i, _mm256_add_ps(_mm256_loadu_ps(p + i), delta));
+		}
+
+		IntegrateSSE(positions + i / 2, velocities + i / 2, accelerations + i / 2, count - i / 2, dt);
+	}
+
+	KINEMATICS_TARGET_AVX2
+	void IntegrateAVX2(Vector2* positions, Vector2* velocities, Vector2 acceleration, std::size_t count, float dt)
+	{
+		float* p = &positions->x;
+		float* v = &velocities->x;
+
+		const float halfDt2 = 0.5f * dt * dt;
+		const float dvx = acceleration.x * dt, dvy = acceleration.y * dt;
+		const float dpx = acceleration.x * halfDt2, dpy = acceleration.y * halfDt2;
+
+		const __m256 vdt = _mm256_set1_ps(dt);
+		const __m256 deltaVelocity = _mm256_setr_ps(dvx, dvy, dvx, dvy, dvx, dvy, dvx, dvy);
+		const __m256 deltaPosition = _mm256_setr_ps(dpx, dpy, dpx, dpy, dpx, dpy, dpx, dpy);
+
+		const std::size_t floats = count * 2;
+		std::size_t i = 0;
+		for (; i + 8 <= floats; i += 8)
+		{
+			const __m256 velocity = _mm256_add_ps(_mm256_loadu_ps(v + i), deltaVelocity);
+			_mm256_storeu_ps(v + i, velocity);
+
+			const __m256 delta = _mm256_add_ps(_mm256_mul_ps(velocity, vdt), deltaPosition);
+			_mm256_storeu_ps(p + i, _mm256_add_ps(_mm256_loadu_ps(p + i), delta));
+		}
+
+		IntegrateSSE(positions + i / 2, velocities + i / 2, acceleration, count - i / 2, dt);
+	}
+
+	KINEMATICS_TARGET_AVX2
+	void AdvanceAVX2(Vector2* positions, const Vector2* velocities, std::size_t count, float dt)
+	{
+		float* p = &positions->x;
+		const float* v = &velocities->x;
+
+		const __m256 vdt = _mm256_set1_ps(dt);
+
+		const std::size_t floats = count * 2;
+		std::size_t i = 0;
+		for (; i + 8 <= floats; i += 8)
+		{
+			_mm256_storeu_ps(p + i, _mm256_add_ps(_mm256_loadu_ps(p + i), _mm256_mul_ps(_mm256_loadu_ps(v + i), vdt)));
+		}
+
+		AdvanceSSE(positions + i / 2, velocities + i / 2, count - i / 2, dt);
+	}
+
+	bool SupportsAVX2()
+	{
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7) return false;
+
+		// AVX with OS support for saving the YMM registers
+		__cpuid(info, 1);
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		const bool avx = (info[2] & (1 << 28)) != 0;
+		if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) return false;
+
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#else
+		return __builtin_cpu_supports("avx2");
+#endif
+	}
+#endif
+
+	// Dispatch //
+
+	struct Kernels
+	{
+		using IntegrateFunction = void(*)(Vector2*, Vector2*, const Vector2*, std::size_t, float);
+		using IntegrateUniformFunction = void(*)(Vector2*, Vector2*, Vector2, std::size_t, float);
+		using AdvanceFunction = void(*)(Vector2*, const Vector2*, std::size_t, float);
+
+		InstructionSet instructionSet;
+		IntegrateFunction integrate;
+		IntegrateUniformFunction integrateUniform;
+		AdvanceFunction advance;
+	};
+
+	Kernels SelectKernels()
+	{
+#if KINEMATICS_X86
+		if (SupportsAVX2())
+		{
+			return { InstructionSet::AVX2, IntegrateAVX2, IntegrateAVX2, AdvanceAVX2 };
+		}
+
+		// SSE2 is part of every x64 CPU
+		return { InstructionSet::SSE, IntegrateSSE, IntegrateSSE, AdvanceSSE };
+#else
+		return { InstructionSet::SCALAR, IntegrateScalar, IntegrateScalar, AdvanceScalar };
+#endif
+	}
+
+	const Kernels& GetKernels()
+	{
+		static const Kernels kernels = SelectKernels();
+		return kernels;
+	}
+
+	InstructionSet GetInstructionSet() { return GetKernels().instructionSet; }
+
+	// Integrates particles with their own acceleration
+	void Integrate(Vector2* positions, Vector2* velocities, const Vector2* accelerations, std::size_t count, float dt)
+	{
+		GetKernels().integrate(positions, velocities, accelerations, count, dt);
+	}
+
+	// Integrates particles sharing the same acceleration
+	void Integrate(Vector2* positions, Vector2* velocities, Vector2 acceleration, std::size_t count, float dt)
+	{
+		GetKernels().integrateUniform(positions, velocities, acceleration, count, dt);
+	}
+
+	// Moves particles without acceleration
+	void Advance(Vector2* positions, const Vector2* velocities, std::size_t count, float dt)
+	{
+		GetKernels().advance(positions, velocities, count, dt);
+	}
+}
@@ -21,19 +21,33 @@ int main()
 			{KEY_FOUR, new ECSPSSceneLoader()},
 		});
 
+	// Simulate at 60Hz whatever the refresh rate, spikes are simulated at most 4 steps deep
+	sceneManager->SetTimestep(1.0f / 60.0f, 4);
+
+	// Per frame metrics are averaged and appended to this file every second, CSV unless it ends in .json
+	if (const char* metricsFile = std::getenv("PARTICLES_METRICS"))
+	{
+		GetMetrics().AddSink(MakeMetricsSink(metricsFile));
+	}
+
 	while (!WindowShouldClose())
 	{
 		if (IsWindowResized())
 		{
 			sceneManager->Resize(GetScreenWidth(), GetScreenHeight());
 		}
-		sceneManager->Update((float)GetTime(), GetFrameTime());
+		sceneManager->Update(GetFrameTime());
 		sceneManager->Draw();
 	}
 
 	// End any open profiling sessions;
 	PROFILE_END_SESSION();
 
+	GetMetrics().ClearSinks();
+
+	// GL resources of the backend go before the context
+	SetRenderBackend(nullptr);
+
 	CloseWindow();
 
 	return 0;
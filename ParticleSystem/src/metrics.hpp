@@ -0,0 +1,426 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+
+enum class MetricType
+{
+	// Nanoseconds accumulated over a frame
+	Timer,
+	// Events summed over a frame
+	Counter,
+	// Last value set, kept across frames
+	Gauge,
+	// Gauge in bytes
+	Memory
+};
+
+const char* ToString(MetricType type)
+{
+	switch (type)
+	{
+	case MetricType::Timer: return "timer";
+	case MetricType::Counter: return "counter";
+	case MetricType::Gauge: return "gauge";
+	default: return "memory";
+	}
+}
+
+// Named value written from any thread. Timers and counters collect into the
+// running frame and are reset when the frame ends, gauges keep their value.
+class Metric
+{
+	std::string name;
+	MetricType type;
+	std::atomic<int64_t> current;
+	std::atomic<bool> isTouched;
+
+	// Owned by the thread ending frames
+	int64_t last;
+	bool isActive;
+	double periodSum;
+	int64_t periodMax;
+	uint32_t periodFrames;
+
+	friend class MetricsRegistry;
+
+public:
+	Metric(const char* name, MetricType type) :
+		name(name),
+		type(type),
+		current(0),
+		isTouched(false),
+		last(0),
+		isActive(false),
+		periodSum(0.0),
+		periodMax(0),
+		periodFrames(0)
+	{
+	}
+
+	const char* GetName() const { return name.c_str(); }
+	MetricType GetType() const { return type; }
+
+	void Add(int64_t value)
+	{
+		current.fetch_add(value, std::memory_order_relaxed);
+		isTouched.store(true, std::memory_order_relaxed);
+	}
+
+	void Set(int64_t value)
+	{
+		current.store(value, std::memory_order_relaxed);
+		isTouched.store(true, std::memory_order_relaxed);
+	}
+
+	// Gauges read their current value, timers and counters the total of the last finished frame
+	int64_t Value() const
+	{
+		return type == MetricType::Gauge || type == MetricType::Memory ? current.load(std::memory_order_relaxed) : last;
+	}
+
+	// Written during the last finished frame, or a gauge still holding a value
+	bool IsActive() const { return isActive; }
+};
+
+// Adds the time spent in the scope to a timer metric
+class ScopedMetricTimer
+{
+	Metric& metric;
+	std::chrono::steady_clock::time_point start;
+
+public:
+	ScopedMetricTimer(Metric& metric) :
+		metric(metric),
+		start(std::chrono::steady_clock::now())
+	{
+	}
+
+	~ScopedMetricTimer()
+	{
+		metric.Add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+	}
+};
+
+// Aggregate of one metric over the frames since the last export. Timers are in
+// milliseconds, everything else in its own unit, per frame.
+struct MetricReport
+{
+	const char* name;
+	MetricType type;
+	double mean;
+	double max;
+	double last;
+};
+
+struct MetricsReport
+{
+	uint64_t frame;
+	double time;
+	uint32_t frames;
+	std::vector<MetricReport> metrics;
+};
+
+class IMetricsSink
+{
+public:
+	virtual void Write(const MetricsReport& report) = 0;
+	virtual ~IMetricsSink() = default;
+};
+
+// One row per metric and export, so metrics can come and go with the scenes
+class CsvMetricsSink : public IMetricsSink
+{
+	std::FILE* file;
+
+public:
+	CsvMetricsSink(const char* fileName) :
+		file(std::fopen(fileName, "a"))
+	{
+		if (!file)
+		{
+			ErrorLog("Could not open metrics file '%s'", fileName);
+			return;
+		}
+
+		// Runs append to the same file, only a new file gets the header
+		std::fseek(file, 0, SEEK_END);
+		if (std::ftell(file) == 0) std::fputs("frame,time,frames,metric,type,mean,max,last\n", file);
+	}
+
+	~CsvMetricsSink()
+	{
+		if (file) std::fclose(file);
+	}
+
+	void Write(const MetricsReport& report) override
+	{
+		if (!file) return;
+
+		for (const auto& metric : report.metrics)
+		{
+			std::fprintf(file, "%llu,%.3f,%u,%s,%s,%.6f,%.6f,%.6f\n",
+				(unsigned long long)report.frame, report.time, report.frames,
+				metric.name, ToString(metric.type), metric.mean, metric.max, metric.last);
+		}
+		std::fflush(file);
+	}
+};
+
+// One JSON object per line and export
+class JsonMetricsSink : public IMetricsSink
+{
+	std::FILE* file;
+
+public:
+	JsonMetricsSink(const char* fileName) :
+		file(std::fopen(fileName, "a"))
+	{
+		if (!file) ErrorLog("Could not open metrics file '%s'", fileName);
+	}
+
+	~JsonMetricsSink()
+	{
+		if (file) std::fclose(file);
+	}
+
+	void Write(const MetricsReport& report) override
+	{
+		if (!file) return;
+
+		std::fprintf(file, "{\"frame\": %llu, \"time\": %.3f, \"frames\": %u, \"metrics\": {",
+			(unsigned long long)report.frame, report.time, report.frames);
+		for (std::size_t i = 0; i < report.metrics.size(); i++)
+		{
+			const auto& metric = report.metrics [i];
+			std::fprintf(file, "%s\"%s\": {\"type\": \"%s\", \"mean\": %.6f, \"max\": %.6f, \"last\": %.6f}",
+				i > 0 ? ", " : "", metric.name, ToString(metric.type), metric.mean, metric.max, metric.last);
+		}
+		std::fputs("}}\n", file);
+		std::fflush(file);
+	}
+};
+
+// Picks the sink from the file extension, CSV unless it ends in .json
+Scoped<IMetricsSink> MakeMetricsSink(const char* fileName)
+{
+	const std::string name = fileName;
+	const bool isJson = name.size() >= 5 && name.compare(name.size() - 5, 5, ".json") == 0;
+	if (isJson) return MakeScoped<JsonMetricsSink>(fileName);
+	return MakeScoped<CsvMetricsSink>(fileName);
+}
+
+// Per frame telemetry of the engines: system and manager timings, spawn / kill
+// counts and pool sizes. Values can be read back at any time, the registry
+// aggregates them per frame and hands the averages to its sinks periodically.
+class MetricsRegistry
+{
+	std::mutex mutex;
+	std::deque<Metric> metrics;
+	std::unordered_map<std::string, Metric*> metricsByName;
+
+	std::vector<Scoped<IMetricsSink>> sinks;
+	float exportInterval;
+	float sinceExport;
+	uint32_t periodFrames;
+
+	uint64_t frame;
+	double time;
+
+	bool isOverlayVisible;
+
+	// Non copyable & moveable
+	MetricsRegistry(const MetricsRegistry&) = delete;
+	MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+public:
+	MetricsRegistry() :
+		exportInterval(1.0f),
+		sinceExport(0.0f),
+		periodFrames(0),
+		frame(0),
+		time(0.0),
+		isOverlayVisible(false)
+	{
+	}
+
+	// Returned references stay valid for the lifetime of the registry
+	Metric& Get(const char* name, MetricType type)
+	{
+		std::lock_guard lock(mutex);
+
+		const auto it = metricsByName.find(name);
+		if (it != metricsByName.end()) return *it->second;
+
+		auto& metric = metrics.emplace_back(name, type);
+		metricsByName.emplace(name, &metric);
+		return metric;
+	}
+
+	// 0 for metrics never written
+	int64_t Value(const char* name)
+	{
+		std::lock_guard lock(mutex);
+
+		const auto it = metricsByName.find(name);
+		return it != metricsByName.end() ? it->second->Value() : 0;
+	}
+
+	uint64_t GetFrame() const { return frame; }
+
+	// Calls function(const Metric&) for every metric written in the last finished frame
+	template<typename Function>
+	void ForEachActive(Function function)
+	{
+		std::lock_guard lock(mutex);
+
+		for (const auto& metric : metrics)
+		{
+			if (metric.IsActive()) function(metric);
+		}
+	}
+
+	void AddSink(Scoped<IMetricsSink> sink)
+	{
+		std::lock_guard lock(mutex);
+		sinks.push_back(std::move(sink));
+	}
+
+	void ClearSinks()
+	{
+		std::lock_guard lock(mutex);
+		sinks.clear();
+	}
+
+	// Zeroes every metric, so gauges of engines no longer running stop being reported
+	void Clear()
+	{
+		std::lock_guard lock(mutex);
+
+		for (auto& metric : metrics)
+		{
+			metric.current = 0;
+			metric.isTouched = false;
+			metric.last = 0;
+			metric.isActive = false;
+			metric.periodSum = 0.0;
+			metric.periodMax = 0;
+			metric.periodFrames = 0;
+		}
+	}
+
+	void SetExportInterval(float seconds) { exportInterval = seconds; }
+
+	bool IsOverlayVisible() const { return isOverlayVisible; }
+	void SetOverlayVisible(bool isVisible) { isOverlayVisible = isVisible; }
+
+	// Closes the running frame, called once per frame by the thread driving the frames
+	void EndFrame(float frameTime)
+	{
+		std::lock_guard lock(mutex);
+
+		frame++;
+		time += frameTime;
+		periodFrames++;
+
+		for (auto& metric : metrics)
+		{
+			const bool isGauge = metric.type == MetricType::Gauge || metric.type == MetricType::Memory;
+			const bool isTouched = metric.isTouched.exchange(false, std::memory_order_relaxed);
+
+			metric.last = isGauge ? metric.current.load(std::memory_order_relaxed) : metric.current.exchange(0, std::memory_order_relaxed);
+			metric.isActive = isTouched || (isGauge && metric.isActive);
+			if (!metric.isActive) continue;
+
+			metric.periodSum += (double)metric.last;
+			metric.periodMax = metric.periodFrames == 0 ? metric.last : std::max(metric.periodMax, metric.last);
+			metric.periodFrames++;
+		}
+
+		sinceExport += frameTime;
+		if (sinceExport >= exportInterval)
+		{
+			Export();
+		}
+	}
+
+private:
+	// Note: you must already own lock on mutex
+	void Export()
+	{
+		MetricsReport report = { frame, time, periodFrames, {} };
+
+		for (auto& metric : metrics)
+		{
+			if (metric.periodFrames == 0) continue;
+
+			const double scale = metric.type == MetricType::Timer ? 1e-6 : 1.0;
+			report.metrics.push_back({
+				metric.GetName(),
+				metric.type,
+				metric.periodSum / metric.periodFrames * scale,
+				metric.periodMax * scale,
+				metric.last * scale
+				});
+
+			metric.periodSum = 0.0;
+			metric.periodMax = 0;
+			metric.periodFrames = 0;
+		}
+
+		for (auto& sink : sinks)
+		{
+			sink->Write(report);
+		}
+
+		sinceExport = 0.0f;
+		periodFrames = 0;
+	}
+};
+
+MetricsRegistry& GetMetrics()
+{
+	static MetricsRegistry metrics;
+	return metrics;
+}
+
+// Lists the metrics of the last finished frame when the overlay is visible
+void DrawMetricsOverlay(int x, int y, int fontSize = 10)
+{
+	auto& metrics = GetMetrics();
+	if (!metrics.IsOverlayVisible()) return;
+
+	metrics.ForEachActive([&](const Metric& metric)
+		{
+			const char* text;
+			switch (metric.GetType())
+			{
+			case MetricType::Timer:
+				text = TextFormat("%s: %.3f ms", metric.GetName(), metric.Value() * 1e-6);
+				break;
+			case MetricType::Memory:
+				text = TextFormat("%s: %s", metric.GetName(), FormatBytes(metric.Value()));
+				break;
+			default:
+				text = TextFormat("%s: %lld", metric.GetName(), (long long)metric.Value());
+				break;
+			}
+
+			DrawText(text, x, y, fontSize, DARKGRAY);
+			y += fontSize + 2;
+		});
+}
+
+// Metrics are looked up once per call site
+#define METRICS_CONCAT2(a, b) a##b
+#define METRICS_CONCAT(a, b) METRICS_CONCAT2(a, b)
+#define METRICS_SCOPE(name) static Metric& METRICS_CONCAT(scopeMetric, __LINE__) = GetMetrics().Get(name, MetricType::Timer);\
+							ScopedMetricTimer METRICS_CONCAT(scopeMetricTimer, __LINE__)(METRICS_CONCAT(scopeMetric, __LINE__))
+#define METRICS_TIME(name, seconds) do { static Metric& metric = GetMetrics().Get(name, MetricType::Timer); metric.Add((int64_t)((seconds) * 1e9)); } while (0)
+#define METRICS_COUNT(name, value) do { static Metric& metric = GetMetrics().Get(name, MetricType::Counter); metric.Add((int64_t)(value)); } while (0)
+#define METRICS_GAUGE(name, value) do { static Metric& metric = GetMetrics().Get(name, MetricType::Gauge); metric.Set((int64_t)(value)); } while (0)
+#define METRICS_MEMORY(name, value) do { static Metric& metric = GetMetrics().Get(name, MetricType::Memory); metric.Set((int64_t)(value)); } while (0)
\ No newline at end of file
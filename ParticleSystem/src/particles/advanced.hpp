@@ -2,13 +2,17 @@
 
 #include "../common.hpp"
 #include "../gradient.hpp"
+#include "../kinematics.hpp"
+#include "../renderbackend.hpp"
+#include "../framepipeline.hpp"
+#include "../metrics.hpp"
+#include "../ring.hpp"
 
 #include "particleemittershape.hpp"
 #include "particledrawers.hpp"
 
 namespace advanced
 {
-	class Particle;
 	class ParticleManager;
 	class ParticleEmitter;
 
@@ -20,6 +24,16 @@ namespace advanced
 		virtual void Release(ParticleEmitter* emitter) = 0;
 		virtual void Update(float time, float dt) = 0;
 		virtual void Draw() = 0;
+		// Particles only, without the stats overlay
+		virtual void DrawParticles() = 0;
+		// Simulates the next frame while the last one is drawn, the drawn frame lags one update behind
+		virtual void SetPipelined(bool isPipelined) = 0;
+		virtual bool IsPipelined() const = 0;
+		// Waits for the frame being simulated, if any
+		virtual void Sync() = 0;
+		// Particles are drawn this fraction of the last update's dt ahead along their velocity
+		virtual void SetInterpolation(float interpolation) = 0;
+		virtual std::size_t ParticleCount() const = 0;
 		virtual ~IParticleManager() = default;
 	};
 
@@ -49,100 +63,83 @@ namespace advanced
 		}
 	};
 
-	struct ParticleData
+	// Structure of arrays storage for every particle spawned by one emitter.
+	// Particles of a block share its SharedParticleData, so nothing per particle
+	// needs to reference it; the emitter addresses its block by effect index.
+	// They also share a lifetime and are spawned in time order, so they expire in
+	// the order they were spawned: the arrays are a ring and expiring particles
+	// only advances its tail, nothing is moved.
+	struct ParticleBlock
 	{
-		uint32_t id;
-		bool isAlive;
-		Color color;
-		float spawnTime;
-		Vector2 size;
-		Vector2 position;
-		Vector2 velocity;
+		Ref<SharedParticleData> sharedData;
+		bool isReleased;
 
-		ParticleData() :
-			id(0),
-			isAlive(false),
-			position(Vector2{}),
-			velocity(Vector2{}),
-			size(Vector2{}),
-			spawnTime(0.f),
-			color(GRAY)
+		FifoRing ring;
+
+		std::vector<Vector2> positions;
+		std::vector<Vector2> velocities;
+		std::vector<Vector2> sizes;
+		std::vector<Color> colors;
+		std::vector<float> spawnTimes;
+
+		static constexpr std::size_t ParticleSize = sizeof(Vector2) * 3 + sizeof(Color) + sizeof(float);
+
+		ParticleBlock() :
+			sharedData(nullptr),
+			isReleased(true)
 		{
 		}
-	};
 
-	class Particle
-	{
-		ParticleData data;
-		Ref<SharedParticleData> sharedData;
+		uint32_t Count() const { return ring.Count(); }
+		uint32_t Capacity() const { return ring.Capacity(); }
 
-		friend ParticleManager;
+		bool IsFree() const { return isReleased && Count() == 0; }
 
-	public:
-		Particle() :
-			data({}),
-			sharedData(nullptr)
+		void Resize(uint32_t capacity)
 		{
+			ring.Resize(capacity, positions, velocities, sizes, colors, spawnTimes);
 		}
 
-		void InitAndApply(Ref<SharedParticleData> sharedData, Vector2 position, Vector2 velocity, float time)
+		// Pushes particles with the shared size and color at the head. Positions and velocities
+		// are left for sample(first, count), called for each span of the arrays they occupy.
+		template<typename Function>
+		void Push(uint32_t spawnCount, float time, Function sample)
 		{
-			this->sharedData = sharedData;
-			
-			data = ParticleData();
-			data.isAlive = true;
-			data.size = sharedData->size;
-			data.color = sharedData->color;
-			data.position = position;
-			data.velocity = velocity;
-			data.spawnTime = time;
+			const auto offset = ring.Push(spawnCount);
+			ring.ForEachSpan(offset, spawnCount, [&](uint32_t first, uint32_t count)
+				{
+					std::fill_n(sizes.begin() + first, count, sharedData->size);
+					std::fill_n(colors.begin() + first, count, sharedData->color);
+					std::fill_n(spawnTimes.begin() + first, count, time);
+					sample(first, count);
+				});
 		}
 
-		void Update(float time, float dt)
+		// Pops the particles older than the shared lifetime, returns how many expired
+		uint32_t Expire(float time)
 		{
-			float t = time - data.spawnTime;
-
-			if (t > sharedData->lifeTime)
-			{
-				data.isAlive = false;
-				return;
-			}
-
-			const auto acceleration = sharedData->acceleration;
-
-			data.velocity.x += acceleration.x * dt;
-			data.velocity.y += acceleration.y * dt;
-
-			data.position.x += data.velocity.x * dt + 0.5f * acceleration.x * dt * dt;
-			data.position.y += data.velocity.y * dt + 0.5f * acceleration.y * dt * dt;
-
-			t = t / sharedData->lifeTime;
-
-			const auto& sizeOverLifetime = sharedData->sizeOverLifetime;
-			if (sizeOverLifetime)
-			{
-				data.size = sizeOverLifetime->Evaluate(t);
-			}
-
-			const auto& colorOverLifetime = sharedData->colorOverLifetime;
-			if (colorOverLifetime)
-			{
-				data.color = colorOverLifetime->Evaluate(t);
-			}
+			const float lifeTime = sharedData->lifeTime;
+			const auto expiredCount = ring.CountPrefix([&](uint32_t index) { return time - spawnTimes [index] > lifeTime; });
+			ring.Pop(expiredCount);
+			return expiredCount;
 		}
 
-		void Draw()
+		void Clear()
 		{
-			if (data.isAlive)
-			{
-				sharedData->drawer->Draw({data.position, data.size, data.color});
-			}
+			sharedData.reset();
+			ring.Clear();
+			positions = {};
+			velocities = {};
+			sizes = {};
+			colors = {};
+			spawnTimes = {};
 		}
 	};
 
 	class ParticleEmitter
 	{
 		int id;
+		uint16_t effect;
 		bool isAlive;
 		bool isSpawning;
 		uint32_t spawnCapacity;
@@ -160,14 +157,16 @@ namespace advanced
 
 		friend ParticleManager;
 
-		Vector2 GetStartPos()
+		void SampleStart(uint32_t count, Vector2* outPositions, Vector2* outVelocities)
 		{
-			return Vector2Add(position, Vector2Rotate(emitterShape->GetStartPos(), rotation * DEG2RAD));
-		}
+			const float radians = rotation * DEG2RAD;
+			emitterShape->SampleBatch(count, radians, position, outPositions, outVelocities);
 
-		Vector2 GetStartVel()
-		{
-			return Vector2Rotate(Vector2Add(sharedParticleData->velocity, emitterShape->GetStartVel()), rotation * DEG2RAD);
+			const Vector2 velocity = Vector2Rotate(sharedParticleData->velocity, radians);
+			for (uint32_t i = 0; i < count; i++)
+			{
+				outVelocities [i] = Vector2Add(outVelocities [i], velocity);
+			}
 		}
 
 	public:
@@ -186,6 +185,7 @@ namespace advanced
 			float spawnRate = 0.0f,
 			uint32_t spawnCount = 1) :
 			id(0),
+			effect(0),
 			isAlive(false),
 			emitterShape(emitterShape),
 			sharedParticleData(sharedParticleData),
@@ -228,11 +228,37 @@ namespace advanced
 
 	class ParticleManager : public IParticleManager
 	{
-		std::vector<Particle> particles;
-		std::vector<Particle> particlePool;
+		std::vector<ParticleBlock> blocks;
+		std::vector<float> normalizedAges;
+
+		// Particles gathered per drawer, kept between frames so the storage is reused
+		struct DrawBucket
+		{
+			Ref<IParticleDrawer> drawer;
+			std::vector<IParticleDrawer::Data> particles;
+		};
+
+		// Everything drawn from one frame. Instanced drawers are packed right away,
+		// the others keep their particles until the frame is submitted.
+		struct FrameSnapshot
+		{
+			std::vector<DrawBucket> drawBuckets;
+			std::size_t bucketCount = 0;
+			ShapeInstanceBuffer shapeInstances;
+		};
+
 		std::unordered_map<uint16_t, ParticleEmitter*> emitters;
 		TUID<uint32_t> emitterTUID;
-		TUID<uint32_t> particleTUID;
+
+		FrameSnapshot frame;
+		Scoped<FramePipeline<FrameSnapshot>> pipeline;
+
+		float interpolation = 0.0f;
+		float lastDeltaTime = 0.0f;
+
+		// Particles spawned and killed since the counters were last recorded
+		uint32_t spawnedCount = 0;
+		uint32_t killedCount = 0;
 
 		// Non copyable & moveable
 		ParticleManager(const ParticleManager&) = delete;
@@ -240,112 +266,324 @@ namespace advanced
 
 	public:
 		ParticleManager() = default;
-		~ParticleManager() = default;
+
+		~ParticleManager()
+		{
+			if (pipeline) pipeline->Wait();
+		}
 
 		void Reserve(ParticleEmitter* emitter) override
 		{
 			PROFILE_FUNCTION();
 
+			if (pipeline) pipeline->Wait();
+
 			emitter->id = emitterTUID.GetNext();
+			emitter->effect = AcquireBlock();
 			emitters.emplace(emitter->id, emitter);
-			ReserveCapacity(emitter->spawnCapacity);
+
+			auto& block = blocks [emitter->effect];
+			block.sharedData = emitter->sharedParticleData;
+			block.isReleased = false;
+			block.Resize(emitter->spawnCapacity);
 		}
 
 		void Spawn(ParticleEmitter* emitter, uint32_t count, float time) override
 		{
 			PROFILE_FUNCTION();
+			METRICS_SCOPE("advanced.Spawn");
 
-			if (particlePool.size() < count)
+			auto& block = blocks [emitter->effect];
+
+			if (block.Count() + count > block.Capacity())
 			{
-				ReserveCapacity(count);
+				block.Resize(std::max(block.Capacity() * 2, block.Count() + count));
 			}
 
-			const auto first = particlePool.begin();
-			const auto last = std::next(first, count);
+			block.Push(count, time, [&](uint32_t first, uint32_t spanCount)
+				{
+					emitter->SampleStart(spanCount, block.positions.data() + first, block.velocities.data() + first);
+				});
+			spawnedCount += count;
+		}
+
+		void Release(ParticleEmitter* emitter) override
+		{
+			PROFILE_FUNCTION();
+
+			if (pipeline) pipeline->Wait();
+
+			// Particles already spawned keep the block until they expire
+			blocks [emitter->effect].isReleased = true;
+			emitters.erase(emitter->id);
+		}
+
+		void Update(float time, float dt) override
+		{
+			PROFILE_FUNCTION();
+			METRICS_SCOPE("advanced.Update");
 
-			for (auto it = first; it != last; ++it)
+			lastDeltaTime = dt;
+
+			if (pipeline)
 			{
-				(*it).InitAndApply(emitter->sharedParticleData, emitter->GetStartPos(), emitter->GetStartVel(), time);
-				particles.push_back(std::move(*it));
+				// The snapshot is drawn next frame, so it uses the factor known now
+				const float offset = interpolation * dt;
+				pipeline->Begin([this, time, dt, offset]
+					{
+						Simulate(time, dt);
+						Pack(pipeline->Back(), offset);
+					});
 			}
+			else
+			{
+				Simulate(time, dt);
+			}
+		}
 
-			particlePool.erase(first, last);
+		void Draw() override
+		{
+			PROFILE_FUNCTION();
+			METRICS_SCOPE("advanced.Draw");
+
+			DrawParticles();
+
+			auto& metrics = GetMetrics();
+			DrawText(TextFormat("Particle Count: %lld / %lld", (long long)metrics.Value("advanced.Particles"), (long long)metrics.Value("advanced.Capacity")), 4, 60, 20, LIME);
+			DrawText(TextFormat("Size in Memory : %s / %s",
+				FormatBytes(metrics.Value("advanced.Bytes")), FormatBytes(metrics.Value("advanced.CapacityBytes"))), 4, 80, 20, LIME);
 		}
 
-		void Release(ParticleEmitter* emitter) override
+		// When pipelined, also waits for the frame being simulated
+		void DrawParticles() override
 		{
 			PROFILE_FUNCTION();
 
-			if (particlePool.size() > emitter->spawnCapacity)
+			if (pipeline)
 			{
-				const auto first = particlePool.begin();
-				const auto last = std::next(first, emitter->spawnCapacity);
-				particlePool.erase(first, last);
+				Submit(pipeline->Front());
+				pipeline->Wait();
+			}
+			else
+			{
+				Pack(frame, interpolation * lastDeltaTime);
+				Submit(frame);
 			}
-			emitters.erase(emitter->id);
 		}
 
-		void Update(float time, float dt) override
+		void SetPipelined(bool isPipelined) override
+		{
+			if (isPipelined == IsPipelined()) return;
+
+			if (pipeline)
+			{
+				pipeline.reset();
+			}
+			else
+			{
+				pipeline = MakeScoped<FramePipeline<FrameSnapshot>>();
+			}
+		}
+
+		bool IsPipelined() const override { return pipeline != nullptr; }
+
+		void Sync() override
+		{
+			if (pipeline) pipeline->Wait();
+		}
+
+		void SetInterpolation(float interpolation) override { this->interpolation = interpolation; }
+
+		std::size_t ParticleCount() const override
+		{
+			std::size_t count = 0;
+			for (const auto& block : blocks)
+			{
+				count += block.Count();
+			}
+			return count;
+		}
+
+	private:
+		void Simulate(float time, float dt)
 		{
 			PROFILE_FUNCTION();
+			METRICS_SCOPE("advanced.Simulate");
 
 			for (const auto& emitter : emitters)
 			{
 				emitter.second->Update(time);
 			}
 
-			FilterAndClean();
+			for (auto& block : blocks)
+			{
+				if (block.Count() == 0)
+				{
+					if (block.isReleased && block.sharedData) block.Clear();
+					continue;
+				}
 
-			for (auto& particle : particles)
+				killedCount += block.Expire(time);
+				UpdateBlock(block, time, dt);
+			}
+
+			RecordMetrics();
+		}
+
+		void RecordMetrics()
+		{
+			std::size_t activeCount = 0;
+			std::size_t totalCount = 0;
+
+			for (const auto& block : blocks)
 			{
-				particle.Update(time, dt);
+				activeCount += block.Count();
+				totalCount += block.Capacity();
 			}
+
+			METRICS_GAUGE("advanced.Particles", activeCount);
+			METRICS_GAUGE("advanced.Capacity", totalCount);
+			METRICS_MEMORY("advanced.Bytes", activeCount * ParticleBlock::ParticleSize);
+			METRICS_MEMORY("advanced.CapacityBytes", totalCount * ParticleBlock::ParticleSize);
+			METRICS_COUNT("advanced.Spawned", spawnedCount);
+			METRICS_COUNT("advanced.Killed", killedCount);
+
+			PROFILE_COUNTER("Particles Alive", activeCount);
+			PROFILE_COUNTER("Particles Spawned", spawnedCount);
+			PROFILE_COUNTER("Particles Killed", killedCount);
+			spawnedCount = 0;
+			killedCount = 0;
 		}
 
-		void Draw() override
+		// Gathers the particles into per drawer buckets, packing the instanced ones.
+		// Particles are moved offset seconds ahead along their velocity.
+		void Pack(FrameSnapshot& snapshot, float offset)
 		{
 			PROFILE_FUNCTION();
+			METRICS_SCOPE("advanced.Pack");
 
-			std::for_each(particles.begin(), particles.end(), [](Particle p) { p.Draw(); });
+			// A frame simulated in several steps only draws the last one
+			ClearSnapshot(snapshot);
 
-			const auto activeCount = particles.size();
-			const auto totalCount = activeCount + particlePool.size();
-			const auto activeSize = activeCount * sizeof(Particle);
-			const auto totalSize = totalCount * sizeof(Particle);
+			for (const auto& block : blocks)
+			{
+				if (!block.sharedData || !block.sharedData->drawer || block.Count() == 0) continue;
+
+				auto& particles = GetDrawBucket(snapshot, block.sharedData->drawer).particles;
+				block.ring.ForEachSpan([&](uint32_t first, uint32_t count)
+					{
+						const std::size_t packed = particles.size();
+						particles.resize(packed + count);
+						for (uint32_t i = 0; i < count; i++)
+						{
+							const auto index = first + i;
+							particles [packed + i] = { Vector2Add(block.positions [index], Vector2Scale(block.velocities [index], offset)), block.sizes [index], block.colors [index] };
+						}
+					});
+			}
+
+			// One call per drawer, instanced drawers are merged into a single shape batch
+			for (std::size_t i = 0; i < snapshot.bucketCount; i++)
+			{
+				auto& bucket = snapshot.drawBuckets [i];
+				if (!bucket.drawer->IsInstanced()) continue;
 
-			DrawText(TextFormat("Particle Count: %d / %d", activeCount, totalCount), 4, 60, 20, LIME);
-			DrawText(TextFormat("Size in Memory : %s / %s", FormatBytes(activeSize), FormatBytes(totalSize)), 4, 80, 20, LIME);
+				bucket.drawer->PackBatch({ bucket.particles.data(), bucket.particles.size() }, snapshot.shapeInstances);
+				bucket.particles.clear();
+			}
 		}
 
-	private:
-		void ReserveCapacity(uint32_t count)
+		// Draws a packed snapshot, main thread only. Immediate mode drawers are drawn first,
+		// in the order their emitters were reserved, then every instanced shape in one batch
+		// on top of them. The snapshot is kept until the next pack, so a frame that ran no
+		// update draws it again.
+		void Submit(FrameSnapshot& snapshot)
 		{
 			PROFILE_FUNCTION();
+			METRICS_SCOPE("advanced.Submit");
 
-			for (uint32_t i = 0; i < count; i++)
+			for (std::size_t i = 0; i < snapshot.bucketCount; i++)
+			{
+				auto& bucket = snapshot.drawBuckets [i];
+				if (!bucket.particles.empty()) bucket.drawer->DrawBatch({ bucket.particles.data(), bucket.particles.size() });
+			}
+
+			if (!snapshot.shapeInstances.IsEmpty())
 			{
-				auto particle = Particle();
-				particle.data.id = particleTUID.GetNext();
-				particlePool.push_back(particle);
+				GetRenderBackend().DrawShapes(snapshot.shapeInstances);
 			}
 		}
 
-		void FilterAndClean()
+		void ClearSnapshot(FrameSnapshot& snapshot)
 		{
-			PROFILE_FUNCTION();
+			for (std::size_t i = 0; i < snapshot.bucketCount; i++)
+			{
+				snapshot.drawBuckets [i].particles.clear();
+				snapshot.drawBuckets [i].drawer = nullptr;
+			}
+			snapshot.bucketCount = 0;
+			snapshot.shapeInstances.Clear();
+		}
 
-			auto removeIt = std::remove_if(particles.begin(), particles.end(),
-				[](const Particle& particle)
-				{
-					return !particle.data.isAlive;
-				});
+		// Scenes use a handful of drawers, a linear search beats hashing
+		DrawBucket& GetDrawBucket(FrameSnapshot& snapshot, const Ref<IParticleDrawer>& drawer)
+		{
+			for (std::size_t i = 0; i < snapshot.bucketCount; i++)
+			{
+				if (snapshot.drawBuckets [i].drawer == drawer) return snapshot.drawBuckets [i];
+			}
+
+			if (snapshot.bucketCount == snapshot.drawBuckets.size()) snapshot.drawBuckets.emplace_back();
+
+			auto& bucket = snapshot.drawBuckets [snapshot.bucketCount++];
+			bucket.drawer = drawer;
+			return bucket;
+		}
 
-			for (auto it = removeIt; it != particles.end(); ++it)
+		uint16_t AcquireBlock()
+		{
+			for (std::size_t i = 0; i < blocks.size(); i++)
 			{
-				particlePool.push_back(std::move(*it));
+				if (blocks [i].IsFree()) return (uint16_t)i;
 			}
 
-			particles.erase(removeIt, particles.end());
+			blocks.emplace_back();
+			return (uint16_t)(blocks.size() - 1);
+		}
+
+		// Expired particles are already popped, so every particle in the ring is alive
+		void UpdateBlock(ParticleBlock& block, float time, float dt)
+		{
+			PROFILE_FUNCTION();
+
+			const auto& sharedData = *block.sharedData;
+			const auto acceleration = sharedData.acceleration;
+			const auto& sizeOverLifetime = sharedData.sizeOverLifetime;
+			const auto& colorOverLifetime = sharedData.colorOverLifetime;
+			const float invLifeTime = 1.0f / sharedData.lifeTime;
+
+			block.ring.ForEachSpan([&](uint32_t first, uint32_t count)
+				{
+					kinematics::Integrate(block.positions.data() + first, block.velocities.data() + first, acceleration, count, dt);
+
+					if (!sizeOverLifetime && !colorOverLifetime) return;
+
+					normalizedAges.resize(count);
+					for (uint32_t i = 0; i < count; i++)
+					{
+						normalizedAges [i] = (time - block.spawnTimes [first + i]) * invLifeTime;
+					}
+
+					if (sizeOverLifetime)
+					{
+						sizeOverLifetime->Evaluate(normalizedAges.data(), block.sizes.data() + first, count);
+					}
+
+					if (colorOverLifetime)
+					{
+						colorOverLifetime->Evaluate(normalizedAges.data(), block.colors.data() + first, count);
+					}
+				});
 		}
 	};
 }
\ No newline at end of file
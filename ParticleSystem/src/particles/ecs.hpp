@@ -2,13 +2,17 @@
 
 #include "../common.hpp"
 #include "../gradient.hpp"
-#include "../batchrenderer.hpp"
+#include "../renderbackend.hpp"
+#include "../framepipeline.hpp"
+#include "../metrics.hpp"
 
 #include "particledrawers.hpp"
 #include "particleemittershape.hpp"
 
 #include "../ecs/common.hpp"
 #include "../ecs/systems.hpp"
+#include "../ecs/scheduler.hpp"
+#include "../ecs/memory.hpp"
 
 namespace ecs
 {
@@ -35,38 +39,85 @@ namespace ecs
 		}
 	};
 
-	template<typename Component>
-	std::pair<std::size_t, std::size_t> ComponentSizeFunction(const ps_registry& reg)
-	{
-		auto count = reg.view<PositionComponent>().size();
-		return std::make_pair(count, (std::size_t)count * sizeof(PositionComponent));
-	}
-
 	class Entity;
 
 	class ParticleManager
 	{
 		ps_registry registry;
 
-		std::vector<std::function<std::pair<std::size_t, std::size_t>(const ps_registry&)>> componentSizeFunctions;
+		MemoryAccounting memoryAccounting;
+
+		ShapeInstanceBuffer shapeInstances;
+
+		std::vector<Vector2> spawnPositions;
+		std::vector<Vector2> spawnVelocities;
+
+		// Components of the particles spawned by one burst, kept between bursts so the storage is reused
+		struct SpawnBatch
+		{
+			std::vector<ps_entity> entities;
+			std::vector<LifetimeComponent> lifetimes;
+			std::vector<PositionComponent> positions;
+			std::vector<VelocityComponent> velocities;
+			std::vector<AccelerationComponent> accelerations;
+			std::vector<RotationComponent> rotations;
+			std::vector<AngularVelocityComponent> angularVelocities;
+			std::vector<AngularAccelerationComponent> angularAccelerations;
+			std::vector<SizeComponent> sizes;
+			std::vector<ColorComponent> colors;
+		};
+
+		SpawnBatch spawnBatch;
+
+		// Particles by death time, and the ones expired in the last lifetime pass, destroyed at the start of the next update
+		ExpiryWheel expiryWheel;
+		DeadEntities deadEntities;
+
+		GroupFollowers groupFollowers;
+
+		ThreadPool threadPool;
+		Scheduler scheduler;
+		float frameTime;
+		float frameDeltaTime;
+		float interpolation;
+
+		// Particles spawned and killed since the counters were last recorded
+		uint32_t spawnedCount;
+		uint32_t killedCount;
+
+		// Render facing state of one frame when pipelined
+		struct FrameSnapshot
+		{
+			ShapeInstanceBuffer shapeInstances;
+			std::vector<PointInstance> points;
+		};
 
-		PointBatchRenderer pointBatchRenderer;
+		// Declared last so a frame still being simulated is waited for before anything else goes
+		Scoped<FramePipeline<FrameSnapshot>> pipeline;
 
 		friend Entity;
 
 	public:
 		ParticleManager() :
-			pointBatchRenderer(1000000)
+			frameTime(0.0f),
+			frameDeltaTime(0.0f),
+			interpolation(0.0f),
+			spawnedCount(0),
+			killedCount(0)
 		{
 			PROFILE_FUNCTION();
 
-			AddComponentSizeFunctions();
+			AddMemoryAccounting();
+			AddStorages();
+			AddSystems();
 		}
 
 		Ref<Entity> SpawnEmitter(SharedParticleData data, uint32_t count, Vector2 position, float rotation, float spawnRate, float time)
 		{
 			PROFILE_FUNCTION();
 
+			if (pipeline) pipeline->Wait();
+
 			auto entity = registry.create();
 
 			registry.emplace<EmitterComponent>(entity, data, count, spawnRate);
@@ -80,195 +131,429 @@ namespace ecs
 		{
 			PROFILE_FUNCTION();
 
-			pointBatchRenderer.SetProjectionMatrix(MatrixOrtho(0, width, height, 0, -1, 1));
+			GetRenderBackend().Resize(width, height);
 		}
 
 		void Update(float time, float dt)
 		{
 			PROFILE_FUNCTION();
+			METRICS_SCOPE("ecs.Update");
+
+			if (pipeline)
+			{
+				// The snapshot is drawn next frame, so it uses the factor known now
+				const float offset = interpolation * dt;
+				pipeline->Begin([this, time, dt, offset]
+					{
+						frameTime = time;
+						frameDeltaTime = dt;
 
-			ecs::DestroyEntitySystem(registry);
-			SpawnParticleSystem(time);
-			auto lifetimeUpdateThread = ecs::LifetimeUpdateSystem(registry, time); 
-			auto kinematicUpdateThread = ecs::KinematicUpdateSystem(registry, dt);
-			auto positionUpdateThread = ecs::PositionUpdateSystem(registry, dt);
-			
-			auto applyVelocityInterpolatedThread = ecs::ApplyInterpolatedVelocitySystem(registry);
-			auto applySizeInterpolatedThread = ecs::ApplyInterpolatedSizeSystem(registry);
-			auto applyColorInterpolatedThread = ecs::ApplyInterpolatedColorSystem(registry);
-
-			auto interpolateVelocityThread = ecs::InterpolateVelocitySystem(registry);
-			auto interpolateSizeThread = ecs::InterpolateSizeSystem(registry);
-			auto interpolateColorThread = ecs::InterpolateColorSystem(registry);
-			auto interpolateRotationThread = ecs::InterpolateRotationSystem(registry);
-			auto interpolateAngularVelocityThread = ecs::InterpolateAngularVelocitySystem(registry);
-		
-			lifetimeUpdateThread.join();
-			kinematicUpdateThread.join();
-			positionUpdateThread.join();
-
-			applyVelocityInterpolatedThread.join();
-			applySizeInterpolatedThread.join();
-			applyColorInterpolatedThread.join();
-			
-			interpolateVelocityThread.join();
-			interpolateSizeThread.join();
-			interpolateColorThread.join();
-			interpolateRotationThread.join();
-			interpolateAngularVelocityThread.join();
+						scheduler.Run(threadPool);
+						RecordMetrics();
+						Pack(pipeline->Back(), offset);
+					});
+			}
+			else
+			{
+				frameTime = time;
+				frameDeltaTime = dt;
 
+				scheduler.Run(threadPool);
+				RecordMetrics();
+			}
 		}
 
 		void Draw()
 		{
 			PROFILE_FUNCTION();
+			METRICS_SCOPE("ecs.Draw");
 
-			ecs::DrawPixelSystem(registry);
-			ecs::DrawCircleSystem(registry);
-			ecs::DrawEllipseSystem(registry);
-			ecs::DrawRectangleSystem(registry);
-			ecs::DrawPointBatchSystem(registry, pointBatchRenderer);
+			DrawParticles();
 
-			// Calculate Registry size
-			const auto registrySize = registry.size();
-			const auto registryAliveSize = registry.alive();
+			auto& metrics = GetMetrics();
+			DrawText(TextFormat("Entities: %lld / %lld / Size: %s",
+				(long long)metrics.Value("ecs.Entities"), (long long)metrics.Value("ecs.EntityCapacity"), FormatBytes(metrics.Value("ecs.EntityBytes"))), 4, 60, 20, LIME);
+			DrawText(TextFormat("Components: %lld / Size: %s", (long long)metrics.Value("ecs.Components"), FormatBytes(metrics.Value("ecs.ComponentBytes"))), 4, 80, 20, LIME);
+		}
 
-			// Calculate the total size of all components
-			std::size_t componentsCount = 0;
-			std::size_t componentsSize = 0;
-			for (const auto& componentSizeFunction : componentSizeFunctions)
+		// Particles only, without the stats overlay. When pipelined, also waits for the frame being simulated
+		void DrawParticles()
+		{
+			PROFILE_FUNCTION();
+
+			auto& backend = GetRenderBackend();
+
+			if (pipeline)
 			{
-				const auto componentSizeResult = componentSizeFunction(registry);
-				componentsCount += componentSizeResult.first;
-				componentsSize += componentSizeResult.second;
+				auto& snapshot = pipeline->Front();
+				if (!snapshot.shapeInstances.IsEmpty()) ecs::DrawShapeBatchSystem(backend, snapshot.shapeInstances);
+				ecs::SubmitPointBatchSystem(backend, snapshot.points);
+
+				pipeline->Wait();
 			}
+			else
+			{
+				const float offset = interpolation * frameDeltaTime;
 
-			DrawText(TextFormat("Entities: %d / %d", registryAliveSize, registrySize), 4, 60, 20, LIME);
-			DrawText(TextFormat("Components: %d / Size: %s", componentsCount, FormatBytes(componentsSize)), 4, 80, 20, LIME);
-		}
+				shapeInstances.Clear();
+				PackShapes(shapeInstances, offset);
+				if (!shapeInstances.IsEmpty()) ecs::DrawShapeBatchSystem(backend, shapeInstances);
 
-	private:
-		template <typename Component, typename T>
-		void CheckAndAddComponent(ps_entity entity, std::optional<T> value)
-		{
-			if (value) registry.emplace<Component>(entity, value.value());
+				ecs::DrawPointBatchSystem(registry, groupFollowers, backend, offset);
+			}
 		}
 
-		template <typename Component, typename T>
-		void CheckAndAddComponent(ps_entity entity, Ref<T> reference)
+		// Simulates the next frame while the last one is drawn, the drawn frame lags one update behind
+		void SetPipelined(bool isPipelined)
 		{
-			if (reference) registry.emplace<Component>(entity, *reference);
+			if (isPipelined == IsPipelined()) return;
+
+			if (pipeline)
+			{
+				pipeline.reset();
+			}
+			else
+			{
+				pipeline = MakeScoped<FramePipeline<FrameSnapshot>>();
+			}
 		}
 
-		void AddComponentSizeFunctions()
+		bool IsPipelined() const { return pipeline != nullptr; }
+
+		// Waits for the frame being simulated, if any
+		void Sync()
 		{
-			componentSizeFunctions.push_back(ComponentSizeFunction<ColorOverLifetimeComponent>);
-			componentSizeFunctions.push_back(ComponentSizeFunction<RotationOverLifetimeComponent>);
-			componentSizeFunctions.push_back(ComponentSizeFunction<SizeOverLifetimeComponent>);
-			componentSizeFunctions.push_back(ComponentSizeFunction<VelocityOverLifetimeComponent>);
-			componentSizeFunctions.push_back(ComponentSizeFunction<AngularVelocityOverLifetimeComponent>);
-			componentSizeFunctions.push_back(ComponentSizeFunction<DestroyEntityComponent>);
-			componentSizeFunctions.push_back(ComponentSizeFunction<PixelDrawComponent>);
-			componentSizeFunctions.push_back(ComponentSizeFunction<CircleDrawComponent>);
-			componentSizeFunctions.push_back(ComponentSizeFunction<EllipseDrawComponent>);
-			componentSizeFunctions.push_back(ComponentSizeFunction<RectDrawComponent>);
-			componentSizeFunctions.push_back(ComponentSizeFunction<RingDrawComponent>);
-			componentSizeFunctions.push_back(ComponentSizeFunction<RectGradientDrawComponent>);
-			componentSizeFunctions.push_back(ComponentSizeFunction<RoundedRectDrawComponent>);
-			componentSizeFunctions.push_back(ComponentSizeFunction<LifetimeComponent>);
-			componentSizeFunctions.push_back(ComponentSizeFunction<PositionComponent>);
-			componentSizeFunctions.push_back(ComponentSizeFunction<VelocityComponent>);
-			componentSizeFunctions.push_back(ComponentSizeFunction<AccelerationComponent>);
-			componentSizeFunctions.push_back(ComponentSizeFunction<RotationComponent>);
-			componentSizeFunctions.push_back(ComponentSizeFunction<AngularVelocityComponent>);
-			componentSizeFunctions.push_back(ComponentSizeFunction<AngularAccelerationComponent>);
-			componentSizeFunctions.push_back(ComponentSizeFunction<SizeComponent>);
-			componentSizeFunctions.push_back(ComponentSizeFunction<ColorComponent>);
+			if (pipeline) pipeline->Wait();
 		}
 
-		// Spawning Particles from Emitters
-		void SpawnParticleSystem(float time)
+		// Particles are drawn this fraction of the last update's dt ahead along their velocity
+		void SetInterpolation(float interpolation) { this->interpolation = interpolation; }
+
+		// Entity pool and per component storage, including capacity and sparse arrays
+		RegistryMemory MeasureMemory() const
 		{
 			PROFILE_FUNCTION();
 
-			registry.view<EmitterComponent, const PositionComponent, const RotationComponent>().each([this, time](auto entity,
-				EmitterComponent& emitter,
-				const PositionComponent& position,
-				const RotationComponent& rotation)
-				{
-					if (emitter.isSpawning && time - emitter.lastSpawnTime > emitter.spawnRate)
-					{
-						Spawn(emitter.data, emitter.spawnCount, position.position, rotation.rotation, time);
-						emitter.lastSpawnTime = time;
-					}
-				});
+			return memoryAccounting.Measure(registry);
+		}
+
+		std::size_t ParticleCount() const
+		{
+			return registry.view<LifetimeComponent>().size();
 		}
 
 		void Spawn(SharedParticleData data, uint32_t count, Vector2 position, float rotation, float time)
 		{
 			PROFILE_FUNCTION();
+			METRICS_SCOPE("ecs.Spawn");
+
+			if (count == 0) return;
 
 			auto emitterShape = data.emitterShape;
+			auto drawType = data.drawType;
 
-			auto velocityOverLifetime = data.velocityOverLifetime;
-			auto rotationOverLifetime = data.rotationOverLifetime;
-			auto angularVelocityOverLifetime = data.angularVelocityOverLifetime;
-			auto sizeOverLifetime = data.sizeOverLifetime;
-			auto colorOverLifetime = data.colorOverLifetime;
+			spawnedCount += count;
+
+			const float radians = rotation * DEG2RAD;
+			spawnPositions.resize(count);
+			spawnVelocities.resize(count);
+			emitterShape->SampleBatch(count, radians, position, spawnPositions.data(), spawnVelocities.data());
+
+			// Optional attributes are set for the whole burst or for none of it
+			const bool hasAcceleration = data.HasAcceleration();
+			const bool hasRotation = data.HasRotation();
+			const bool hasAngularVelocity = data.HasAngularVelocity();
+			const bool hasAngularAcceleration = data.HasAngularAcceleration();
+
+			auto& batch = spawnBatch;
+			batch.lifetimes.resize(count);
+			batch.positions.resize(count);
+			batch.velocities.resize(count);
+			batch.accelerations.resize(hasAcceleration ? count : 0);
+			batch.rotations.resize(hasRotation ? count : 0);
+			batch.angularVelocities.resize(hasAngularVelocity ? count : 0);
+			batch.angularAccelerations.resize(hasAngularAcceleration ? count : 0);
+			batch.sizes.resize(count);
+			batch.colors.resize(count);
+
+			// One random value per particle drives all of its attributes
+			for (uint32_t i = 0; i < count; i++)
+			{
+				data.Randomize();
 
-			auto drawType = data.drawType;
+				batch.lifetimes [i] = { data.GetLifetime(), time };
+				batch.positions [i] = { spawnPositions [i] };
+				batch.velocities [i] = { Vector2Add(Vector2Rotate(data.GetVelocity(), radians), spawnVelocities [i]) };
+				if (hasAcceleration) batch.accelerations [i] = { data.GetAcceleration().value() };
+				if (hasRotation) batch.rotations [i] = { data.GetRotation().value() };
+				if (hasAngularVelocity) batch.angularVelocities [i] = { data.GetAngularVelocity().value() };
+				if (hasAngularAcceleration) batch.angularAccelerations [i] = { data.GetAngularAcceleration().value() };
+				batch.sizes [i] = { data.GetSize() };
+				batch.colors [i] = { data.GetColor() };
+			}
 
-			for (int i = count - 1; i >= 0; --i)
+			// Entities and every component pool grow once per burst
+			batch.entities.resize(count);
+			registry.create(batch.entities.begin(), batch.entities.end());
+
+			InsertComponents(batch.lifetimes);
+			for (uint32_t i = 0; i < count; i++)
 			{
-				auto entity = registry.create();
+				expiryWheel.Insert(batch.entities [i], time + batch.lifetimes [i].lifetime);
+			}
+			InsertComponents(batch.positions);
+			InsertComponents(batch.velocities);
+			InsertComponents(batch.accelerations);
+			InsertComponents(batch.rotations);
+			InsertComponents(batch.angularVelocities);
+			InsertComponents(batch.angularAccelerations);
+			InsertComponents(batch.sizes);
+			InsertComponents(batch.colors);
+
+			CheckAndInsertComponent<VelocityOverLifetimeComponent>(data.velocityOverLifetime);
+			CheckAndInsertComponent<RotationOverLifetimeComponent>(data.rotationOverLifetime);
+			CheckAndInsertComponent<AngularVelocityOverLifetimeComponent>(data.angularVelocityOverLifetime);
+			CheckAndInsertComponent<SizeOverLifetimeComponent>(data.sizeOverLifetime);
+			CheckAndInsertComponent<ColorOverLifetimeComponent>(data.colorOverLifetime);
+
+			switch (drawType)
+			{
+			default:
+			case DrawType::PIXEL: InsertComponent<PixelDrawComponent>();
+				break;
+			case DrawType::CIRCLE: InsertComponent<CircleDrawComponent>();
+				break;
+			case DrawType::ELLIPSE: InsertComponent<EllipseDrawComponent>();
+				break;
+			case DrawType::RING: InsertComponent<RingDrawComponent>(data.ringDrawCompProto);
+				break;
+			case DrawType::RECT: InsertComponent<RectDrawComponent>();
+				break;
+			case DrawType::RECT_GRADIENT: InsertComponent<RectGradientDrawComponent>(data.rectGradDrawCompProto);
+				break;
+			case DrawType::ROUNDED_RECT: InsertComponent<RoundedRectDrawComponent>(data.roundedRectDrawCompProto);
+				break;
+			case DrawType::BATCH_CIRCLE: InsertComponent<CircleBatchDrawComponent>();
+				break;
+			case DrawType::POINT: InsertComponent<PointBatchDrawComponent>();
+				break;
+			}
 
-				data.Randomize();
+			groupFollowers.Update(registry);
+		}
+
+	private:
+		// Runs after the systems, on the simulation thread when pipelined
+		void RecordMetrics()
+		{
+			const auto memory = MeasureMemory();
+
+			METRICS_GAUGE("ecs.Particles", ParticleCount());
+			METRICS_GAUGE("ecs.Entities", memory.entities);
+			METRICS_GAUGE("ecs.EntityCapacity", memory.entityCapacity);
+			METRICS_MEMORY("ecs.EntityBytes", memory.entityBytes);
+			METRICS_GAUGE("ecs.Components", memory.componentCount);
+			METRICS_GAUGE("ecs.ComponentCapacity", memory.componentCapacity);
+			METRICS_MEMORY("ecs.ComponentBytes", memory.componentBytes);
+			METRICS_COUNT("ecs.Spawned", spawnedCount);
+			METRICS_COUNT("ecs.Killed", killedCount);
+
+			PROFILE_COUNTER("Particles Alive", ParticleCount());
+			PROFILE_COUNTER("Particles Spawned", spawnedCount);
+			PROFILE_COUNTER("Particles Killed", killedCount);
+			spawnedCount = 0;
+			killedCount = 0;
+		}
+
+		void PackShapes(ShapeInstanceBuffer& instances, float offset)
+		{
+			ecs::PackPixelSystem(registry, groupFollowers, instances, offset);
+			ecs::PackCircleSystem(registry, groupFollowers, instances, offset);
+			ecs::PackEllipseSystem(registry, groupFollowers, instances, offset);
+			ecs::PackRectangleSystem(registry, groupFollowers, instances, offset);
+			ecs::PackRectangleGradientSystem(registry, groupFollowers, instances, offset);
+			ecs::PackRoundedRectangleSystem(registry, groupFollowers, instances, offset);
+			ecs::PackRingSystem(registry, groupFollowers, instances, offset);
+		}
 
-				registry.emplace<LifetimeComponent>(entity, data.GetLifetime(), time);
+		// Runs on the simulation thread, the registry is not touched by the main thread meanwhile
+		void Pack(FrameSnapshot& snapshot, float offset)
+		{
+			PROFILE_FUNCTION();
+			METRICS_SCOPE("ecs.Pack");
 
-				Vector2 pos = Vector2Add(position, Vector2Rotate(emitterShape->GetStartPos(), rotation * DEG2RAD));
-				registry.emplace<PositionComponent>(entity, pos);
+			// A frame simulated in several steps only draws the last one
+			snapshot.shapeInstances.Clear();
 
-				Vector2 vel = Vector2Rotate(Vector2Add(data.GetVelocity(), emitterShape->GetStartVel()), rotation * DEG2RAD);
-				registry.emplace<VelocityComponent>(entity, vel);
-				CheckAndAddComponent<VelocityOverLifetimeComponent>(entity, velocityOverLifetime);
-				CheckAndAddComponent<AccelerationComponent>(entity, data.GetAcceleration());
+			PackShapes(snapshot.shapeInstances, offset);
+			ecs::PackPointBatchSystem(registry, groupFollowers, snapshot.points, offset);
+		}
 
-				CheckAndAddComponent<RotationComponent>(entity, data.GetRotation());
-				CheckAndAddComponent<RotationOverLifetimeComponent>(entity, rotationOverLifetime);
-				CheckAndAddComponent<AngularVelocityComponent>(entity, data.GetAngularVelocity());
-				CheckAndAddComponent<AngularVelocityOverLifetimeComponent>(entity, angularVelocityOverLifetime);
-				CheckAndAddComponent<AngularAccelerationComponent>(entity, data.GetAngularAcceleration());
+		// The Insert helpers add a component to every entity of the spawn batch
 
-				CheckAndAddComponent<SizeOverLifetimeComponent>(entity, sizeOverLifetime);
-				registry.emplace<SizeComponent>(entity, data.GetSize());
+		// One value per entity, empty arrays are skipped
+		template <typename Component>
+		void InsertComponents(const std::vector<Component>& components)
+		{
+			if (components.empty()) return;
+			registry.insert<Component>(spawnBatch.entities.begin(), spawnBatch.entities.end(), components.begin());
+		}
 
-				CheckAndAddComponent<ColorOverLifetimeComponent>(entity, colorOverLifetime);
-				registry.emplace<ColorComponent>(entity, data.GetColor());
+		// The same value for every entity
+		template <typename Component>
+		void InsertComponent(const Component& value = {})
+		{
+			registry.insert<Component>(spawnBatch.entities.begin(), spawnBatch.entities.end(), value);
+		}
 
-				switch (drawType)
+		template <typename Component, typename T>
+		void CheckAndInsertComponent(Ref<T> reference)
+		{
+			if (reference) InsertComponent<Component>(*reference);
+		}
+
+		// Storages and groups are created up front, so systems running in parallel never insert into the registry
+		void AddStorages()
+		{
+			registry.storage<EmitterComponent>();
+			registry.storage<ColorOverLifetimeComponent>();
+			registry.storage<RotationOverLifetimeComponent>();
+			registry.storage<SizeOverLifetimeComponent>();
+			registry.storage<VelocityOverLifetimeComponent>();
+			registry.storage<AngularVelocityOverLifetimeComponent>();
+			registry.storage<PixelDrawComponent>();
+			registry.storage<CircleDrawComponent>();
+			registry.storage<PointBatchDrawComponent>();
+			registry.storage<CircleBatchDrawComponent>();
+			registry.storage<EllipseDrawComponent>();
+			registry.storage<RectDrawComponent>();
+			registry.storage<RingDrawComponent>();
+			registry.storage<RectGradientDrawComponent>();
+			registry.storage<RoundedRectDrawComponent>();
+			registry.storage<LifetimeComponent>();
+			registry.storage<PositionComponent>();
+			registry.storage<VelocityComponent>();
+			registry.storage<AccelerationComponent>();
+			registry.storage<RotationComponent>();
+			registry.storage<AngularVelocityComponent>();
+			registry.storage<AngularAccelerationComponent>();
+			registry.storage<SizeComponent>();
+			registry.storage<ColorComponent>();
+
+			ecs::ParticleGroup(registry);
+			ecs::AcceleratedParticleGroup(registry);
+
+			groupFollowers.Add<ColorOverLifetimeComponent>();
+			groupFollowers.Add<RotationOverLifetimeComponent>();
+			groupFollowers.Add<SizeOverLifetimeComponent>();
+			groupFollowers.Add<VelocityOverLifetimeComponent>();
+			groupFollowers.Add<AngularVelocityOverLifetimeComponent>();
+			groupFollowers.Add<PixelDrawComponent>();
+			groupFollowers.Add<CircleDrawComponent>();
+			groupFollowers.Add<PointBatchDrawComponent>();
+			groupFollowers.Add<EllipseDrawComponent>();
+			groupFollowers.Add<RectDrawComponent>();
+			groupFollowers.Add<RingDrawComponent>();
+			groupFollowers.Add<RectGradientDrawComponent>();
+			groupFollowers.Add<RoundedRectDrawComponent>();
+		}
+
+		// Systems are listed in the order they logically run in,
+		// the scheduler only parallelizes systems that don't share components.
+		void AddSystems()
+		{
+			scheduler.AddExclusive("DestroyEntitySystem", [this]
 				{
-				default:
-				case DrawType::PIXEL: registry.emplace<PixelDrawComponent>(entity);
-					break;
-				case DrawType::CIRCLE: registry.emplace<CircleDrawComponent>(entity);
-					break;
-				case DrawType::ELLIPSE: registry.emplace<EllipseDrawComponent>(entity);
-					break;
-				case DrawType::RING: registry.emplace<RingDrawComponent>(entity, data.ringDrawCompProto);
-					break;
-				case DrawType::RECT: registry.emplace<RectDrawComponent>(entity);
-					break;
-				case DrawType::RECT_GRADIENT: registry.emplace<RectGradientDrawComponent>(entity, data.rectGradDrawCompProto);
-					break;
-				case DrawType::ROUNDED_RECT: registry.emplace<RoundedRectDrawComponent>(entity, data.roundedRectDrawCompProto);
-					break;
-				case DrawType::BATCH_CIRCLE: registry.emplace<CircleBatchDrawComponent>(entity);
-					break;
-				case DrawType::POINT: registry.emplace<PointBatchDrawComponent>(entity);
-					break;
-				}
-			}
+					killedCount += (uint32_t)ecs::DestroyEntitySystem(registry, deadEntities);
+					groupFollowers.Update(registry);
+				});
+			scheduler.AddExclusive("SpawnParticleSystem", [this] { SpawnParticleSystem(frameTime); });
+
+			scheduler.Add("LifetimeUpdateSystem",
+				Read<>{}, Write<ExpiryWheel, DeadEntities>{},
+				[this] { ecs::LifetimeUpdateSystem(registry, frameTime, expiryWheel, deadEntities); });
+
+			scheduler.Add("InterpolateVelocitySystem",
+				Read<LifetimeComponent>{}, Write<VelocityOverLifetimeComponent>{},
+				[this] { ecs::InterpolateVelocitySystem(registry, groupFollowers, frameTime); });
+			scheduler.Add("InterpolateSizeSystem",
+				Read<LifetimeComponent>{}, Write<SizeOverLifetimeComponent>{},
+				[this] { ecs::InterpolateSizeSystem(registry, groupFollowers, frameTime); });
+			scheduler.Add("InterpolateColorSystem",
+				Read<LifetimeComponent>{}, Write<ColorOverLifetimeComponent>{},
+				[this] { ecs::InterpolateColorSystem(registry, groupFollowers, frameTime); });
+			scheduler.Add("InterpolateRotationSystem",
+				Read<LifetimeComponent>{}, Write<RotationOverLifetimeComponent>{},
+				[this] { ecs::InterpolateRotationSystem(registry, groupFollowers, frameTime); });
+			scheduler.Add("InterpolateAngularVelocitySystem",
+				Read<LifetimeComponent>{}, Write<AngularVelocityOverLifetimeComponent>{},
+				[this] { ecs::InterpolateAngularVelocitySystem(registry, groupFollowers, frameTime); });
+
+			scheduler.Add("ApplyInterpolatedVelocitySystem",
+				Read<VelocityOverLifetimeComponent>{}, Write<VelocityComponent>{},
+				[this] { ecs::ApplyInterpolatedVelocitySystem(registry, groupFollowers); });
+			scheduler.Add("ApplyInterpolatedSizeSystem",
+				Read<SizeOverLifetimeComponent, LifetimeComponent>{}, Write<SizeComponent>{},
+				[this] { ecs::ApplyInterpolatedSizeSystem(registry, groupFollowers); });
+			scheduler.Add("ApplyInterpolatedColorSystem",
+				Read<ColorOverLifetimeComponent, LifetimeComponent>{}, Write<ColorComponent>{},
+				[this] { ecs::ApplyInterpolatedColorSystem(registry, groupFollowers); });
+
+			scheduler.Add("KinematicUpdateSystem",
+				Read<AccelerationComponent>{}, Write<PositionComponent, VelocityComponent>{},
+				[this] { ecs::KinematicUpdateSystem(registry, frameDeltaTime); });
+			scheduler.Add("PositionUpdateSystem",
+				Read<VelocityComponent, AccelerationComponent>{}, Write<PositionComponent>{},
+				[this] { ecs::PositionUpdateSystem(registry, frameDeltaTime); });
+
+			scheduler.Build();
+		}
+
+		// Every component type the registry stores
+		void AddMemoryAccounting()
+		{
+			memoryAccounting.Add<EmitterComponent>(registry, "EmitterComponent");
+			memoryAccounting.Add<ColorOverLifetimeComponent>(registry, "ColorOverLifetimeComponent");
+			memoryAccounting.Add<RotationOverLifetimeComponent>(registry, "RotationOverLifetimeComponent");
+			memoryAccounting.Add<SizeOverLifetimeComponent>(registry, "SizeOverLifetimeComponent");
+			memoryAccounting.Add<VelocityOverLifetimeComponent>(registry, "VelocityOverLifetimeComponent");
+			memoryAccounting.Add<AngularVelocityOverLifetimeComponent>(registry, "AngularVelocityOverLifetimeComponent");
+			memoryAccounting.Add<PixelDrawComponent>(registry, "PixelDrawComponent");
+			memoryAccounting.Add<CircleDrawComponent>(registry, "CircleDrawComponent");
+			memoryAccounting.Add<PointBatchDrawComponent>(registry, "PointBatchDrawComponent");
+			memoryAccounting.Add<CircleBatchDrawComponent>(registry, "CircleBatchDrawComponent");
+			memoryAccounting.Add<EllipseDrawComponent>(registry, "EllipseDrawComponent");
+			memoryAccounting.Add<RectDrawComponent>(registry, "RectDrawComponent");
+			memoryAccounting.Add<RingDrawComponent>(registry, "RingDrawComponent");
+			memoryAccounting.Add<RectGradientDrawComponent>(registry, "RectGradientDrawComponent");
+			memoryAccounting.Add<RoundedRectDrawComponent>(registry, "RoundedRectDrawComponent");
+			memoryAccounting.Add<LifetimeComponent>(registry, "LifetimeComponent");
+			memoryAccounting.Add<PositionComponent>(registry, "PositionComponent");
+			memoryAccounting.Add<VelocityComponent>(registry, "VelocityComponent");
+			memoryAccounting.Add<AccelerationComponent>(registry, "AccelerationComponent");
+			memoryAccounting.Add<RotationComponent>(registry, "RotationComponent");
+			memoryAccounting.Add<AngularVelocityComponent>(registry, "AngularVelocityComponent");
+			memoryAccounting.Add<AngularAccelerationComponent>(registry, "AngularAccelerationComponent");
+			memoryAccounting.Add<SizeComponent>(registry, "SizeComponent");
+			memoryAccounting.Add<ColorComponent>(registry, "ColorComponent");
+		}
+
+		// Spawning Particles from Emitters
+		void SpawnParticleSystem(float time)
+		{
+			PROFILE_FUNCTION();
+
+			registry.view<EmitterComponent, const PositionComponent, const RotationComponent>().each([this, time](auto entity,
+				EmitterComponent& emitter,
+				const PositionComponent& position,
+				const RotationComponent& rotation)
+				{
+					if (emitter.isSpawning && time - emitter.lastSpawnTime > emitter.spawnRate)
+					{
+						Spawn(emitter.data, emitter.spawnCount, position.position, rotation.rotation, time);
+						emitter.lastSpawnTime = time;
+					}
+				});
 		}
 	};
 
@@ -303,24 +588,30 @@ namespace ecs
 		template<typename... Component>
 		[[nodiscard]] decltype(auto) TryGetComponent()
 		{
-			return manager->registry.try_get<Component>(entity);
+			return manager->registry.try_get<Component...>(entity);
 		}
 
 		template<typename Component, typename... Args>
 		decltype(auto) AddComponent(Args &&...args)
 		{
+			manager->Sync();
+			manager->groupFollowers.Invalidate();
 			return manager->registry.emplace<Component>(entity, std::forward<Args>(args)...);
 		}
 
 		template<typename Component, typename... Args>
 		decltype(auto) GetOrAddComponent(Args &&...args)
 		{
+			manager->Sync();
+			manager->groupFollowers.Invalidate();
 			return manager->registry.get_or_emplace<Component>(entity, std::forward<Args>(args)...);
 		}
 
 		template<typename Component, typename... Other>
 		void RemoveComponent()
 		{
+			manager->Sync();
+			manager->groupFollowers.Invalidate();
 			manager->registry.remove<Component, Other...>(entity);
 		}
 	};
@@ -352,6 +643,31 @@ namespace ecs
 		manager->Draw();
 	}
 
+	void SetPipelined(bool isPipelined)
+	{
+		manager->SetPipelined(isPipelined);
+	}
+
+	bool IsPipelined()
+	{
+		return manager->IsPipelined();
+	}
+
+	void Sync()
+	{
+		manager->Sync();
+	}
+
+	void SetInterpolation(float interpolation)
+	{
+		manager->SetInterpolation(interpolation);
+	}
+
+	RegistryMemory MeasureMemory()
+	{
+		return manager->MeasureMemory();
+	}
+
 	void Destroy()
 	{
 		manager.reset();
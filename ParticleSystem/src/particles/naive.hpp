@@ -2,6 +2,7 @@
 
 #include "../common.hpp"
 #include "../gradient.hpp"
+#include "../metrics.hpp"
 
 namespace naive
 {
@@ -108,6 +109,10 @@ namespace naive
 		float lastSpawnTime;
 		bool isSpawning;
 
+		// Particles spawned and killed since the counters were last recorded
+		uint32_t spawnedCount = 0;
+		uint32_t killedCount = 0;
+
 	public:
 		Vector2 position;
 
@@ -126,6 +131,7 @@ namespace naive
 		void Spawn(uint32_t count, float time)
 		{
 			PROFILE_FUNCTION();
+			METRICS_SCOPE("naive.Spawn");
 
 			for (int i = count - 1; i >= 0; --i)
 			{
@@ -136,6 +142,7 @@ namespace naive
 		void Update(float time, float dt)
 		{
 			PROFILE_FUNCTION();
+			METRICS_SCOPE("naive.Update");
 
 			if (isSpawning && time - lastSpawnTime > spawnRate)
 			{
@@ -149,19 +156,39 @@ namespace naive
 			}
 
 			CleanUp();
+
+			METRICS_GAUGE("naive.Particles", particles.size());
+			METRICS_GAUGE("naive.Capacity", particles.capacity());
+			METRICS_MEMORY("naive.Bytes", particles.size() * (sizeof(Particle) + sizeof(Scoped<Particle>)));
+			METRICS_MEMORY("naive.CapacityBytes", particles.size() * sizeof(Particle) + particles.capacity() * sizeof(Scoped<Particle>));
+			METRICS_COUNT("naive.Spawned", spawnedCount);
+			METRICS_COUNT("naive.Killed", killedCount);
+
+			PROFILE_COUNTER("Particles Alive", particles.size());
+			PROFILE_COUNTER("Particles Spawned", spawnedCount);
+			PROFILE_COUNTER("Particles Killed", killedCount);
+			spawnedCount = 0;
+			killedCount = 0;
 		}
 
 		void Draw()
 		{
 			PROFILE_FUNCTION();
+			METRICS_SCOPE("naive.Draw");
 
 			for (int i = (int)particles.size() - 1; i >= 0; --i)
 			{
 				particles [i]->Draw();
 			}
 
-			DrawText(TextFormat("Particle Count: %d", particles.size()), 4, 60, 20, LIME);
-			DrawText(TextFormat("Size in Memory : %s", FormatBytes(particles.size() * sizeof(Particle))), 4, 80, 20, LIME);
+			auto& metrics = GetMetrics();
+			DrawText(TextFormat("Particle Count: %lld", (long long)metrics.Value("naive.Particles")), 4, 60, 20, LIME);
+			DrawText(TextFormat("Size in Memory : %s", FormatBytes(metrics.Value("naive.Bytes"))), 4, 80, 20, LIME);
+		}
+
+		std::size_t ParticleCount() const
+		{
+			return particles.size();
 		}
 
 	private:
@@ -173,12 +200,16 @@ namespace naive
 												{
 													return !particle->isAlive;
 												});
+			killedCount += (uint32_t)std::distance(deadParticles, particles.end());
 			particles.erase(deadParticles, particles.end());
 		}
 
 		void Spawn(float time)
 		{
-			PROFILE_FUNCTION();
+			// Runs once per particle
+			PROFILE_FUNCTION_SAMPLED(64);
+
+			spawnedCount++;
 
 			auto particle = new Particle(baseParticleData);
 			particle->spawnTime = time;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../common.hpp"
+#include "../shapeinstances.hpp"
 
 class IParticleDrawer
 {
@@ -13,36 +14,85 @@ public:
 	};
 	virtual void Draw(const Data& data) = 0;
 	virtual ~IParticleDrawer() = default;
+
+	// Draws a contiguous run of particles sharing this drawer with a single virtual call
+	virtual void DrawBatch(Span<const Data> batch) = 0;
+
+	// Instanced drawers pack particles for the ShapeBatchRenderer instead of drawing them
+	virtual bool IsInstanced() const { return false; }
+	virtual void PackBatch(Span<const Data>, ShapeInstanceBuffer&) {}
 };
 
-class PixelParticleDrawer : public IParticleDrawer
+// Drawers write Draw and Pack for one particle, the batch loops call them without virtual dispatch
+template<typename Drawer>
+class BatchParticleDrawer : public IParticleDrawer
 {
 public:
-	void Draw(const Data& data)
+	void DrawBatch(Span<const Data> batch) override
+	{
+		auto& drawer = static_cast<Drawer&>(*this);
+		for (const auto& data : batch)
+		{
+			drawer.Drawer::Draw(data);
+		}
+	}
+
+	bool IsInstanced() const override { return true; }
+
+	void PackBatch(Span<const Data> batch, ShapeInstanceBuffer& instances) override
+	{
+		auto& drawer = static_cast<Drawer&>(*this);
+		for (const auto& data : batch)
+		{
+			drawer.Drawer::Pack(data, instances);
+		}
+	}
+};
+
+class PixelParticleDrawer : public BatchParticleDrawer<PixelParticleDrawer>
+{
+public:
+	void Draw(const Data& data) override
 	{
 		DrawPixelV(data.position, data.color);
 	}
+
+	// A 1x1 rectangle covers the same pixel DrawPixelV does
+	void Pack(const Data& data, ShapeInstanceBuffer& instances)
+	{
+		instances.AddRect(data.position, { 1.0f, 1.0f }, data.color);
+	}
 };
 
-class CircleParticleDrawer : public IParticleDrawer
+class CircleParticleDrawer : public BatchParticleDrawer<CircleParticleDrawer>
 {
 public:
-	void Draw(const Data& data)
+	void Draw(const Data& data) override
 	{
 		DrawCircleV(data.position, data.size.x, data.color);
 	}
+
+	void Pack(const Data& data, ShapeInstanceBuffer& instances)
+	{
+		instances.AddCircle(data.position, data.size.x, data.color);
+	}
 };
 
-class EllipseParticleDrawer : public IParticleDrawer
+class EllipseParticleDrawer : public BatchParticleDrawer<EllipseParticleDrawer>
 {
 public:
-	void Draw(const Data& data)
+	void Draw(const Data& data) override
 	{
 		DrawEllipse((int)data.position.x, (int)data.position.y, data.size.x, data.size.y, data.color);
 	}
+
+	void Pack(const Data& data, ShapeInstanceBuffer& instances)
+	{
+		instances.AddEllipse(data.position, data.size, data.color);
+	}
 };
 
-class RingParticleDrawer : public IParticleDrawer
+class RingParticleDrawer : public BatchParticleDrawer<RingParticleDrawer>
 {
 	float startAngle;
 	float endAngle;
@@ -53,22 +103,32 @@ public:
 	{
 	}
 
-	void Draw(const Data& data)
+	void Draw(const Data& data) override
 	{
 		DrawRing(data.position, data.size.x, data.size.y, startAngle, endAngle, segments, data.color);
 	}
+
+	void Pack(const Data& data, ShapeInstanceBuffer& instances)
+	{
+		instances.AddRing(data.position, data.size.x, data.size.y, startAngle, endAngle, segments, data.color);
+	}
 };
 
-class RectParticleDrawer : public IParticleDrawer
+class RectParticleDrawer : public BatchParticleDrawer<RectParticleDrawer>
 {
 public:
-	void Draw(const Data& data)
+	void Draw(const Data& data) override
 	{
 		DrawRectangleV(data.position, data.size, data.color);
 	}
+
+	void Pack(const Data& data, ShapeInstanceBuffer& instances)
+	{
+		instances.AddRect(data.position, data.size, data.color);
+	}
 };
 
-class RectGradientParticleDrawer : public IParticleDrawer
+class RectGradientParticleDrawer : public BatchParticleDrawer<RectGradientParticleDrawer>
 {
 	Color other;
 	bool order;
@@ -77,7 +137,7 @@ class RectGradientParticleDrawer : public IParticleDrawer
 public:
 	RectGradientParticleDrawer(Color other, bool isHorizontal = true, bool order = true) : other(other), isHorizontal(isHorizontal), order(order) {}
 
-	void Draw(const Data& data)
+	void Draw(const Data& data) override
 	{
 		if (isHorizontal)
 		{
@@ -88,9 +148,14 @@ public:
 			DrawRectangleGradientV((int)data.position.x, (int)data.position.y, (int)data.size.x, (int)data.size.y, order ? data.color : other, order ? other : data.color);
 		}
 	}
+
+	void Pack(const Data& data, ShapeInstanceBuffer& instances)
+	{
+		instances.AddRectGradient(data.position, data.size, order ? data.color : other, order ? other : data.color, isHorizontal);
+	}
 };
 
-class RoundedRectParticleDrawer : public IParticleDrawer
+class RoundedRectParticleDrawer : public BatchParticleDrawer<RoundedRectParticleDrawer>
 {
 	float roundness;
 	int segments;
@@ -98,8 +163,13 @@ class RoundedRectParticleDrawer : public IParticleDrawer
 public:
 	RoundedRectParticleDrawer(float roundness, int segments = 3) : roundness(roundness), segments(segments) {}
 
-	void Draw(const Data& data)
+	void Draw(const Data& data) override
 	{
 		DrawRectangleRounded({ data.position.x, data.position.y, data.size.x, data.size.y }, roundness, segments, data.color);
 	}
+
+	void Pack(const Data& data, ShapeInstanceBuffer& instances)
+	{
+		instances.AddRoundedRect(data.position, data.size, roundness, data.color);
+	}
 };
\ No newline at end of file
@@ -8,6 +8,43 @@ public:
 	virtual Vector2 GetStartPos() = 0;
 	virtual Vector2 GetStartVel() = 0;
 	virtual ~IEmitterShape() = default;
+
+	// Samples count start positions and velocities, rotated by rotation (radians)
+	// and with positions offset by origin. Shapes override this to sample a whole
+	// burst at once instead of going through two virtual calls per particle.
+	virtual void SampleBatch(std::size_t count, float rotation, Vector2 origin, Vector2* outPositions, Vector2* outVelocities)
+	{
+		for (std::size_t i = 0; i < count; i++)
+		{
+			outPositions [i] = GetStartPos();
+			outVelocities [i] = GetStartVel();
+		}
+
+		Transform(outPositions, count, rotation, origin);
+		Transform(outVelocities, count, rotation, Zero);
+	}
+
+protected:
+	// Rotates then offsets every vector, the rotation is computed once for the batch
+	static void Transform(Vector2* vectors, std::size_t count, float rotation, Vector2 offset)
+	{
+		const float cosRotation = cosf(rotation);
+		const float sinRotation = sinf(rotation);
+
+		for (std::size_t i = 0; i < count; i++)
+		{
+			const Vector2 v = vectors [i];
+			vectors [i] = {
+				offset.x + v.x * cosRotation - v.y * sinRotation,
+				offset.y + v.x * sinRotation + v.y * cosRotation
+			};
+		}
+	}
+
+	static void Fill(Vector2* vectors, std::size_t count, Vector2 value)
+	{
+		std::fill_n(vectors, count, value);
+	}
 };
 
 class LineEmitterShape : public IEmitterShape
@@ -18,6 +55,13 @@ public:
 	LineEmitterShape(float width) : width(width) {}
 	Vector2 GetStartPos() override { return { RandomSpread(width), 0.0f }; }
 	Vector2 GetStartVel() override { return Zero; }
+
+	void SampleBatch(std::size_t count, float rotation, Vector2 origin, Vector2* outPositions, Vector2* outVelocities) override
+	{
+		RandomFill(outPositions, count, { -width, width }, Zero);
+		Transform(outPositions, count, rotation, origin);
+		Fill(outVelocities, count, Zero);
+	}
 };
 
 class BoxEmitterShape : public IEmitterShape
@@ -54,6 +98,25 @@ public:
 	}
 
 	Vector2 GetStartVel() override { return Zero; }
+
+	void SampleBatch(std::size_t count, float rotation, Vector2 origin, Vector2* outPositions, Vector2* outVelocities) override
+	{
+		RandomFill(outPositions, count, { -width, width }, { -height, height });
+
+		if (isOutline)
+		{
+			// Velocities are zero for boxes, so they hold the coin flips picking the edge
+			RandomFill(outVelocities, count, { 0.0f, 1.0f }, Zero);
+			for (std::size_t i = 0; i < count; i++)
+			{
+				if (outVelocities [i].x < 0.5f) outPositions [i].y = 0.0f;
+				else outPositions [i].x = 0.0f;
+			}
+		}
+
+		Transform(outPositions, count, rotation, origin);
+		Fill(outVelocities, count, Zero);
+	}
 };
 
 class CircleEmitterShape : public IEmitterShape
@@ -74,11 +137,27 @@ public:
 		else
 		{
 			float dist = Random(0.f, radius);
-			return { dist * cosf(angle), radius * sinf(angle) };
+			return { dist * cosf(angle), dist * sinf(angle) };
 		}
 	}
 
 	Vector2 GetStartVel() override { return Zero; }
+
+	void SampleBatch(std::size_t count, float rotation, Vector2 origin, Vector2* outPositions, Vector2* outVelocities) override
+	{
+		// Sampled as (angle, distance) pairs, the emitter rotation is folded into the angle
+		const Vector2 distanceRange = isOutline ? Vector2 { radius, radius } : Vector2 { 0.0f, radius };
+		RandomFill(outPositions, count, { rotation, rotation + 2 * PI }, distanceRange);
+
+		for (std::size_t i = 0; i < count; i++)
+		{
+			const float angle = outPositions [i].x;
+			const float distance = outPositions [i].y;
+			outPositions [i] = { origin.x + distance * cosf(angle), origin.y + distance * sinf(angle) };
+		}
+
+		Fill(outVelocities, count, Zero);
+	}
 };
 
 class ConeEmitterShape : public IEmitterShape
@@ -110,4 +189,21 @@ public:
 		float angle = RandomSpread(this->angle * DEG2RAD);
 		return Vector2Rotate({ 0.0f, Random(minMaxIntensity.x, minMaxIntensity.y) }, angle);
 	}
+
+	void SampleBatch(std::size_t count, float rotation, Vector2 origin, Vector2* outPositions, Vector2* outVelocities) override
+	{
+		RandomFill(outPositions, count, { -baseWidth, baseWidth }, Zero);
+		Transform(outPositions, count, rotation, origin);
+
+		// Sampled as (angle, intensity) pairs, the emitter rotation is folded into the angle
+		const float spread = this->angle * DEG2RAD;
+		RandomFill(outVelocities, count, { rotation - spread, rotation + spread }, minMaxIntensity);
+
+		for (std::size_t i = 0; i < count; i++)
+		{
+			const float angle = outVelocities [i].x;
+			const float intensity = outVelocities [i].y;
+			outVelocities [i] = { -intensity * sinf(angle), intensity * cosf(angle) };
+		}
+	}
 };
\ No newline at end of file
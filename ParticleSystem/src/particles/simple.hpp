@@ -1,7 +1,11 @@
 ﻿#pragma once
 
 #include "../common.hpp"
+#include "../curve.hpp"
 #include "../gradient.hpp"
+#include "../kinematics.hpp"
+#include "../metrics.hpp"
+#include "../ring.hpp"
 
 #include "particleemittershape.hpp"
 
@@ -24,6 +28,7 @@ namespace simple
 		virtual void Release(ParticleEmitter* emitter) = 0;
 		virtual void Update(float time, float dt) = 0;
 		virtual void Draw() = 0;
+		virtual std::size_t ParticleCount() const = 0;
 		virtual ~IParticleManager() = default;
 	};
 
@@ -38,7 +43,7 @@ namespace simple
 		float lifeTime;
 		float size;
 		Ref<naive::Gradient> colorOverLifetime;
-		Ref<Vector2> sizeOverLifetime;
+		Ref<Curve<float>> sizeOverLifetime;
 
 		SharedParticleData() :
 			acceleration({ 0.f, 0.f }),
@@ -55,18 +60,12 @@ namespace simple
 	struct ParticleData
 	{
 		uint32_t id;
-		bool isAlive;
 		float spawnTime;
 		float size;
 		Color color;
-		Vector2 position;
-		Vector2 velocity;
 
 		ParticleData() :
 			id(0),
-			isAlive(false),
-			position(Vector2 { 0.f, 0.f }),
-			velocity(Vector2 { 0.f, 0.f }),
 			size(1.f),
 			spawnTime(0.f),
 			color(GRAY)
@@ -88,43 +87,25 @@ namespace simple
 		{
 		}
 
-		void InitAndApply(Ref<SharedParticleData> sharedData, Vector2 position, Vector2 velocity, float time)
+		void InitAndApply(Ref<SharedParticleData> sharedData, float time)
 		{
 			this->sharedData = sharedData;
 
 			data = ParticleData();
-			data.isAlive = true;
 			data.size = sharedData->size;
 			data.color = sharedData->color;
-			data.position = position;
-			data.velocity = velocity;
 			data.spawnTime = time;
 		}
 
-		void Update(float time, float dt)
+		// Expired particles are popped and positions integrated by the manager before the update
+		void Update(float time)
 		{
-			float t = time - data.spawnTime;
-
-			if (t > sharedData->lifeTime)
-			{
-				data.isAlive = false;
-				return;
-			}
-
-			const auto acceleration = sharedData->acceleration;
-
-			data.velocity.x += acceleration.x * dt;
-			data.velocity.y += acceleration.y * dt;
-
-			data.position.x += data.velocity.x * dt + 0.5f * acceleration.x * dt * dt;
-			data.position.y += data.velocity.y * dt + 0.5f * acceleration.y * dt * dt;
-
-			t = t / sharedData->lifeTime;
+			const float t = (time - data.spawnTime) / sharedData->lifeTime;
 
 			const auto& sizeOverLifetime = sharedData->sizeOverLifetime;
 			if (sizeOverLifetime)
 			{
-				data.size = Lerp(sizeOverLifetime->x, sizeOverLifetime->y, t);
+				data.size = sizeOverLifetime->Evaluate(t);
 			}
 
 			const auto& colorOverLifetime = sharedData->colorOverLifetime;
@@ -134,18 +115,16 @@ namespace simple
 			}
 		}
 
-		void Draw()
+		void Draw(Vector2 position)
 		{
-			if (data.isAlive)
-			{
-				DrawCircleV(data.position, data.size, data.color);
-			}
+			DrawCircleV(position, data.size, data.color);
 		}
 	};
 
 	class ParticleEmitter
 	{
 		int id;
+		uint16_t block;
 		bool isAlive;
 		bool isSpawning;
 		uint32_t spawnCapacity;
@@ -164,14 +143,15 @@ namespace simple
 
 		friend ParticleManager;
 
-		Vector2 GetStartPos()
+		void SampleStart(uint32_t count, Vector2* outPositions, Vector2* outVelocities)
 		{
-			return Vector2Add(position, Vector2Rotate(emitterShape->GetStartPos(), rotation));
-		}
+			emitterShape->SampleBatch(count, rotation, position, outPositions, outVelocities);
 
-		Vector2 GetStartVel()
-		{
-			return Vector2Rotate(Vector2Add(sharedParticleData->velocity, emitterShape->GetStartVel()), rotation);
+			const Vector2 velocity = Vector2Rotate(sharedParticleData->velocity, rotation);
+			for (uint32_t i = 0; i < count; i++)
+			{
+				outVelocities [i] = Vector2Add(outVelocities [i], velocity);
+			}
 		}
 
 	public:
@@ -190,6 +170,7 @@ namespace simple
 						float spawnRate = 0.0f,
 						uint32_t spawnCount = 1) :
 			id(0),
+			block(0),
 			isAlive(false),
 			emitterShape(emitterShape),
 			sharedParticleData(sharedParticleData),
@@ -235,12 +216,34 @@ namespace simple
 
 	class ParticleManager : public IParticleManager
 	{
-		std::vector<Particle> particles;
-		std::vector<Particle> particlePool;
+		// Particles of one emitter. They share a lifetime and are spawned in time
+		// order, so they expire in the order they were spawned: the slab is a ring,
+		// spawning pushes at its head and expiring only advances its tail.
+		// Positions and velocities are kept apart from the particles, so the
+		// kinematics kernels integrate whole contiguous spans of them.
+		struct ParticleBlock
+		{
+			Ref<SharedParticleData> sharedData;
+			bool isReleased = true;
+			FifoRing ring;
+			std::vector<Particle> particles;
+			std::vector<Vector2> positions;
+			std::vector<Vector2> velocities;
+
+			static constexpr std::size_t ParticleSize = sizeof(Particle) + sizeof(Vector2) * 2;
+
+			bool IsFree() const { return isReleased && ring.Count() == 0; }
+		};
+
+		std::vector<ParticleBlock> blocks;
 		std::unordered_map<uint16_t, ParticleEmitter*> emitters;
 		TUID<uint32_t> emitterTUID;
 		TUID<uint32_t> particleTUID;
 
+		// Particles spawned and killed since the counters were last recorded
+		uint32_t spawnedCount = 0;
+		uint32_t killedCount = 0;
+
 		// Non copyable & moveable
 		ParticleManager(const ParticleManager&) = delete;
 		ParticleManager& operator=(const ParticleManager&) = delete;
@@ -254,105 +257,179 @@ namespace simple
 			PROFILE_FUNCTION();
 
 			emitter->id = emitterTUID.GetNext();
+			emitter->block = AcquireBlock();
 			emitters.emplace(emitter->id, emitter);
-			ReserveCapacity(emitter->spawnCapacity);
+
+			auto& block = blocks [emitter->block];
+			block.sharedData = emitter->sharedParticleData;
+			block.isReleased = false;
+			ReserveCapacity(block, emitter->spawnCapacity);
 		}
 
 		void Spawn(ParticleEmitter* emitter, uint32_t count, float time) override
 		{
 			PROFILE_FUNCTION();
+			METRICS_SCOPE("simple.Spawn");
 
-			if (particlePool.size() < count)
+			auto& block = blocks [emitter->block];
+			auto& ring = block.ring;
+
+			if (ring.Free() < count)
 			{
-				ReserveCapacity(count);
+				ReserveCapacity(block, std::max(ring.Capacity() * 2, ring.Count() + count));
 			}
 
-			const auto first = particlePool.begin();
-			const auto last = std::next(first, count);
+			const auto offset = ring.Push(count);
+			ring.ForEachSpan(offset, count, [&](uint32_t first, uint32_t spanCount)
+				{
+					emitter->SampleStart(spanCount, block.positions.data() + first, block.velocities.data() + first);
 
-			for (auto it = first; it != last; ++it)
-			{
-				(*it).InitAndApply(emitter->sharedParticleData, emitter->GetStartPos(), emitter->GetStartVel(), time);
-				particles.push_back(std::move(*it));
-			}
+					for (uint32_t i = first; i < first + spanCount; i++)
+					{
+						block.particles [i].InitAndApply(block.sharedData, time);
+					}
+				});
 
-			particlePool.erase(first, last);
+			spawnedCount += count;
 		}
 
 		void Release(ParticleEmitter* emitter) override
 		{
 			PROFILE_FUNCTION();
 
-			if (particlePool.size() > emitter->spawnCapacity)
-			{
-				const auto first = particlePool.begin();
-				const auto last = std::next(first, emitter->spawnCapacity);
-				particlePool.erase(first, last);
-			}
+			// Particles already spawned keep the block until they expire
+			blocks [emitter->block].isReleased = true;
 			emitters.erase(emitter->id);
 		}
 
 		void Update(float time, float dt) override
 		{
 			PROFILE_FUNCTION();
+			METRICS_SCOPE("simple.Update");
 
 			for (const auto& emitter : emitters)
 			{
 				emitter.second->Update(time);
 			}
 
-			FilterAndClean();
+			std::size_t aliveCount = 0;
+			std::size_t capacity = 0;
 
-			for (auto& particle : particles)
+			for (auto& block : blocks)
 			{
-				particle.Update(time, dt);
+				if (block.ring.Count() == 0)
+				{
+					if (block.isReleased && block.sharedData) ClearBlock(block);
+					continue;
+				}
+
+				Expire(block, time);
+
+				const auto acceleration = block.sharedData->acceleration;
+				block.ring.ForEachSpan([&](uint32_t first, uint32_t count)
+					{
+						kinematics::Integrate(block.positions.data() + first, block.velocities.data() + first, acceleration, count, dt);
+
+						for (uint32_t i = first; i < first + count; i++)
+						{
+							block.particles [i].Update(time);
+						}
+					});
+
+				aliveCount += block.ring.Count();
+				capacity += block.ring.Capacity();
 			}
+
+			METRICS_GAUGE("simple.Particles", aliveCount);
+			METRICS_GAUGE("simple.Capacity", capacity);
+			METRICS_MEMORY("simple.Bytes", aliveCount * ParticleBlock::ParticleSize);
+			METRICS_MEMORY("simple.CapacityBytes", capacity * ParticleBlock::ParticleSize);
+			METRICS_COUNT("simple.Spawned", spawnedCount);
+			METRICS_COUNT("simple.Killed", killedCount);
+
+			PROFILE_COUNTER("Particles Alive", aliveCount);
+			PROFILE_COUNTER("Particles Spawned", spawnedCount);
+			PROFILE_COUNTER("Particles Killed", killedCount);
+			spawnedCount = 0;
+			killedCount = 0;
 		}
 
 		void Draw() override
 		{
 			PROFILE_FUNCTION();
+			METRICS_SCOPE("simple.Draw");
 
-			std::for_each(particles.begin(), particles.end(), [] (Particle p) { p.Draw(); });
+			for (auto& block : blocks)
+			{
+				block.ring.ForEachSpan([&](uint32_t first, uint32_t count)
+					{
+						for (uint32_t i = first; i < first + count; i++)
+						{
+							block.particles [i].Draw(block.positions [i]);
+						}
+					});
+			}
 
-			const auto activeCount = particles.size();
-			const auto totalCount = activeCount + particlePool.size();
-			const auto activeSize = activeCount * sizeof(Particle);
-			const auto totalSize = totalCount * sizeof(Particle);
+			auto& metrics = GetMetrics();
+			DrawText(TextFormat("Particle Count: %lld / %lld", (long long)metrics.Value("simple.Particles"), (long long)metrics.Value("simple.Capacity")), 4, 60, 20, LIME);
+			DrawText(TextFormat("Size in Memory : %s / %s",
+				FormatBytes(metrics.Value("simple.Bytes")), FormatBytes(metrics.Value("simple.CapacityBytes"))), 4, 80, 20, LIME);
+		}
 
-			DrawText(TextFormat("Particle Count: %d / %d", activeCount, totalCount), 4, 60, 20, LIME);
-			DrawText(TextFormat("Size in Memory : %s / %s", FormatBytes(activeSize), FormatBytes(totalSize)), 4, 80, 20, LIME);
+		std::size_t ParticleCount() const override
+		{
+			std::size_t count = 0;
+			for (const auto& block : blocks)
+			{
+				count += block.ring.Count();
+			}
+			return count;
 		}
 
 	private:
-		void ReserveCapacity(uint32_t count)
+		void ReserveCapacity(ParticleBlock& block, uint32_t capacity)
 		{
 			PROFILE_FUNCTION();
 
-			for (uint32_t i = 0; i < count; i++)
+			const auto first = block.particles.size();
+			block.ring.Resize(capacity, block.particles, block.positions, block.velocities);
+
+			for (auto i = first; i < block.particles.size(); i++)
 			{
-				auto particle = Particle();
-				particle.data.id = particleTUID.GetNext();
-				particlePool.push_back(particle);
+				block.particles [i].data.id = particleTUID.GetNext();
 			}
 		}
 
-		void FilterAndClean()
+		void ClearBlock(ParticleBlock& block)
 		{
-			PROFILE_FUNCTION();
-
-			auto removeIt = std::remove_if(particles.begin(), particles.end(),
-										   [] (const Particle& particle)
-										   {
-											   return !particle.data.isAlive;
-										   });
+			block.sharedData.reset();
+			block.ring.Clear();
+			block.particles = {};
+			block.positions = {};
+			block.velocities = {};
+		}
 
-			for (auto it = removeIt; it != particles.end(); ++it)
+		uint16_t AcquireBlock()
+		{
+			for (std::size_t i = 0; i < blocks.size(); i++)
 			{
-				particlePool.push_back(std::move(*it));
+				if (blocks [i].IsFree()) return (uint16_t)i;
 			}
 
-			particles.erase(removeIt, particles.end());
+			blocks.emplace_back();
+			return (uint16_t)(blocks.size() - 1);
+		}
+
+		// Particles of a block expire in spawn order, the expired ones are found by binary search
+		void Expire(ParticleBlock& block, float time)
+		{
+			PROFILE_FUNCTION();
+
+			const float lifeTime = block.sharedData->lifeTime;
+			const auto expiredCount = block.ring.CountPrefix([&](uint32_t index) { return time - block.particles [index].data.spawnTime > lifeTime; });
+
+			block.ring.Pop(expiredCount);
+			killedCount += expiredCount;
 		}
 	};
 }
\ No newline at end of file
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <random>
+
+#include <raylib.h>
+#include <raymath.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define RANDOM_X86 1
+#include <emmintrin.h>
+#else
+#define RANDOM_X86 0
+#endif
+
+// xoshiro128+ generator, fast and good enough for floats.
+// Bulk fills run four independent generators side by side, one per SIMD lane.
+class RandomStream
+{
+	static constexpr int Lanes = 4;
+
+	uint32_t state[4];
+	alignas(16) uint32_t lanes[4][Lanes];
+
+public:
+	RandomStream(uint64_t seed = 0, uint64_t stream = 0) { Seed(seed, stream); }
+
+	// Streams with the same seed but a different stream index are independent
+	void Seed(uint64_t seed, uint64_t stream = 0)
+	{
+		uint64_t splitmix = seed ^ (stream * 0xD1B54A32D192ED03ull);
+		auto next = [&splitmix]
+		{
+			uint64_t z = (splitmix += 0x9E3779B97F4A7C15ull);
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+			return (uint32_t)(z ^ (z >> 31));
+		};
+
+		for (auto& word : state) word = next();
+		for (auto& lane : lanes)
+		{
+			for (auto& word : lane) word = next();
+		}
+	}
+
+	uint32_t NextUInt()
+	{
+		const uint32_t result = state[0] + state[3];
+		const uint32_t t = state[1] << 9;
+
+		state[2] ^= state[0];
+		state[3] ^= state[1];
+		state[1] ^= state[2];
+		state[0] ^= state[3];
+		state[2] ^= t;
+		state[3] = (state[3] << 11) | (state[3] >> 21);
+
+		return result;
+	}
+
+	// [0, 1)
+	float NextFloat() { return (NextUInt() >> 8) * (1.0f / 16777216.0f); }
+
+	float Range(float min, float max) { return min + NextFloat() * (max - min); }
+
+	// Fills out with count floats in [min, max)
+	void Fill(float* out, std::size_t count, float min = 0.0f, float max = 1.0f)
+	{
+		const float scale = (max - min) * (1.0f / 16777216.0f);
+
+		std::size_t i = 0;
+#if RANDOM_X86
+		__m128i s0 = _mm_load_si128((const __m128i*)lanes[0]);
+		__m128i s1 = _mm_load_si128((const __m128i*)lanes[1]);
+		__m128i s2 = _mm_load_si128((const __m128i*)lanes[2]);
+		__m128i s3 = _mm_load_si128((const __m128i*)lanes[3]);
+
+		const __m128 vmin = _mm_set1_ps(min);
+		const __m128 vscale = _mm_set1_ps(scale);
+
+		for (; i + Lanes <= count; i += Lanes)
+		{
+			const __m128i result = _mm_add_epi32(s0, s3);
+			const __m128i t = _mm_slli_epi32(s1, 9);
+
+			s2 = _mm_xor_si128(s2, s0);
+			s3 = _mm_xor_si128(s3, s1);
+			s1 = _mm_xor_si128(s1, s2);
+			s0 = _mm_xor_si128(s0, s3);
+			s2 = _mm_xor_si128(s2, t);
+			s3 = _mm_or_si128(_mm_slli_epi32(s3, 11), _mm_srli_epi32(s3, 21));
+
+			const __m128 value = _mm_cvtepi32_ps(_mm_srli_epi32(result, 8));
+			_mm_storeu_ps(out + i, _mm_add_ps(vmin, _mm_mul_ps(value, vscale)));
+		}
+
+		_mm_store_si128((__m128i*)lanes[0], s0);
+		_mm_store_si128((__m128i*)lanes[1], s1);
+		_mm_store_si128((__m128i*)lanes[2], s2);
+		_mm_store_si128((__m128i*)lanes[3], s3);
+#endif
+
+		for (; i < count; i++)
+		{
+			out[i] = min + (NextUInt() >> 8) * scale;
+		}
+	}
+
+	// Fills out with count vectors, x in [rangeX.x, rangeX.y) and y in [rangeY.x, rangeY.y)
+	void Fill(Vector2* out, std::size_t count, Vector2 rangeX, Vector2 rangeY)
+	{
+		float* values = &out->x;
+		Fill(values, count * 2);
+
+		const float scaleX = rangeX.y - rangeX.x;
+		const float scaleY = rangeY.y - rangeY.x;
+
+		std::size_t i = 0;
+#if RANDOM_X86
+		const __m128 vmin = _mm_setr_ps(rangeX.x, rangeY.x, rangeX.x, rangeY.x);
+		const __m128 vscale = _mm_setr_ps(scaleX, scaleY, scaleX, scaleY);
+
+		for (; i + 4 <= count * 2; i += 4)
+		{
+			_mm_storeu_ps(values + i, _mm_add_ps(vmin, _mm_mul_ps(_mm_loadu_ps(values + i), vscale)));
+		}
+#endif
+
+		for (; i < count * 2; i += 2)
+		{
+			values[i] = rangeX.x + values[i] * scaleX;
+			values[i + 1] = rangeY.x + values[i + 1] * scaleY;
+		}
+	}
+};
+
+// Seed shared by every thread stream, changing it reseeds them on their next use
+std::atomic<uint64_t> randomSeed = ((uint64_t)std::random_device{}() << 32) | std::random_device{}();
+std::atomic<uint32_t> randomGeneration = 0;
+std::atomic<uint32_t> randomThreadCount = 0;
+
+void SeedRandom(uint64_t seed)
+{
+	randomSeed = seed;
+	randomGeneration++;
+}
+
+// Each thread owns its stream, so random numbers can be drawn from parallel code without locking
+RandomStream& ThreadRandom()
+{
+	thread_local RandomStream stream;
+	thread_local uint32_t generation = randomGeneration - 1;
+	thread_local const uint32_t threadIndex = randomThreadCount++;
+
+	const uint32_t current = randomGeneration.load(std::memory_order_relaxed);
+	if (generation != current)
+	{
+		stream.Seed(randomSeed, threadIndex);
+		generation = current;
+	}
+	return stream;
+}
+
+float Random()
+{
+	return ThreadRandom().NextFloat();
+}
+
+float Random(float min, float max)
+{
+	return ThreadRandom().Range(min, max);
+}
+
+float RandomSpread(float spread)
+{
+	return Random(-spread, spread);
+}
+
+Vector2 RandomVector2(float min, float max)
+{
+	auto& stream = ThreadRandom();
+	return Vector2 { stream.Range(min, max), stream.Range(min, max) };
+}
+
+Vector2 RandomVector2(Vector2 rangeX, Vector2 rangeY)
+{
+	auto& stream = ThreadRandom();
+	return Vector2 { stream.Range(rangeX.x, rangeX.y), stream.Range(rangeY.x, rangeY.y) };
+}
+
+void RandomFill(float* out, std::size_t count, float min = 0.0f, float max = 1.0f)
+{
+	ThreadRandom().Fill(out, count, min, max);
+}
+
+void RandomFill(Vector2* out, std::size_t count, Vector2 rangeX, Vector2 rangeY)
+{
+	ThreadRandom().Fill(out, count, rangeX, rangeY);
+}
\ No newline at end of file
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "common.hpp"
+#include "shapeinstances.hpp"
+#include "batchrenderer.hpp"
+
+// Receives the batched primitives of the particle managers. Drawers and draw
+// systems only produce points and shape instances, the backend decides whether
+// they end up on the GPU or in a CPU framebuffer.
+class IRenderBackend
+{
+public:
+	virtual const char* GetName() const = 0;
+	virtual void Resize(int width, int height) = 0;
+
+	// Same contract as PointBatchRenderer::Reserve, points are drawn by FlushPoints
+	virtual Span<PointInstance> ReservePoints(uint32_t count) = 0;
+	virtual void FlushPoints() = 0;
+
+	// Instances are drawn in order, the buffer can be cleared once this returns
+	virtual void DrawShapes(const ShapeInstanceBuffer& instances) = 0;
+
+	virtual ~IRenderBackend() = default;
+};
+
+// Draws through the GL batch renderers, meant to be used between BeginDrawing / EndDrawing
+class RaylibRenderBackend : public IRenderBackend
+{
+	// Created on first use so a backend can exist before the GL context
+	Scoped<PointBatchRenderer> pointBatchRenderer;
+	Scoped<ShapeBatchRenderer> shapeBatchRenderer;
+	Matrix projection;
+
+	uint32_t pointCapacity;
+	uint32_t shapeCapacity;
+
+public:
+	RaylibRenderBackend(uint32_t pointCapacity = 1000000, uint32_t shapeCapacity = 100000) :
+		pointBatchRenderer(nullptr),
+		shapeBatchRenderer(nullptr),
+		projection(MatrixIdentity()),
+		pointCapacity(pointCapacity),
+		shapeCapacity(shapeCapacity)
+	{
+	}
+
+	const char* GetName() const override { return "raylib"; }
+
+	void Resize(int width, int height) override
+	{
+		projection = MatrixOrtho(0, width, height, 0, -1, 1);
+		if (pointBatchRenderer) pointBatchRenderer->SetProjectionMatrix(projection);
+	}
+
+	Span<PointInstance> ReservePoints(uint32_t count) override
+	{
+		return GetPointBatchRenderer().Reserve(count);
+	}
+
+	void FlushPoints() override
+	{
+		if (pointBatchRenderer) pointBatchRenderer->Draw();
+	}
+
+	void DrawShapes(const ShapeInstanceBuffer& instances) override
+	{
+		if (instances.IsEmpty()) return;
+		GetShapeBatchRenderer().Draw(instances);
+	}
+
+private:
+	PointBatchRenderer& GetPointBatchRenderer()
+	{
+		if (!pointBatchRenderer)
+		{
+			pointBatchRenderer = MakeScoped<PointBatchRenderer>(pointCapacity);
+			pointBatchRenderer->SetProjectionMatrix(projection);
+		}
+		return *pointBatchRenderer;
+	}
+
+	ShapeBatchRenderer& GetShapeBatchRenderer()
+	{
+		if (!shapeBatchRenderer)
+		{
+			shapeBatchRenderer = MakeScoped<ShapeBatchRenderer>(shapeCapacity);
+		}
+		return *shapeBatchRenderer;
+	}
+};
+
+// Backend used by every particle manager, the raylib one unless another is set
+Scoped<IRenderBackend> renderBackend;
+
+IRenderBackend& GetRenderBackend()
+{
+	if (!renderBackend)
+	{
+		renderBackend = MakeScoped<RaylibRenderBackend>();
+	}
+	return *renderBackend;
+}
+
+void SetRenderBackend(Scoped<IRenderBackend> backend)
+{
+	renderBackend = std::move(backend);
+}
\ No newline at end of file
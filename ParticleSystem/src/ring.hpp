@@ -0,0 +1,112 @@
+#pragma once
+
+#include "common.hpp"
+
+// Indices of a FIFO over storage of a fixed capacity. Elements are pushed at the
+// head and popped from the tail, the live range [tail, tail + count) wraps around
+// the end of the storage, so any part of it is at most two contiguous spans.
+class FifoRing
+{
+	uint32_t tail;
+	uint32_t count;
+	uint32_t capacity;
+
+public:
+	FifoRing() :
+		tail(0),
+		count(0),
+		capacity(0)
+	{
+	}
+
+	uint32_t Tail() const { return tail; }
+	uint32_t Count() const { return count; }
+	uint32_t Capacity() const { return capacity; }
+	uint32_t Free() const { return capacity - count; }
+
+	// Storage index of the element offset places after the tail
+	uint32_t Index(uint32_t offset) const
+	{
+		const uint32_t index = tail + offset;
+		return index < capacity ? index : index - capacity;
+	}
+
+	// Returns the offset of the first pushed element, the storage must have room for count more
+	uint32_t Push(uint32_t pushCount)
+	{
+		const auto first = count;
+		count += pushCount;
+		return first;
+	}
+
+	void Pop(uint32_t popCount)
+	{
+		tail = Index(popCount);
+		count -= popCount;
+		if (count == 0) tail = 0;
+	}
+
+	// Elements at the tail for which predicate(index) holds. The predicate must
+	// hold for a prefix of the ring, which is then found by binary search.
+	template<typename Predicate>
+	uint32_t CountPrefix(Predicate predicate) const
+	{
+		uint32_t first = 0;
+		uint32_t last = count;
+		while (first < last)
+		{
+			const uint32_t middle = first + (last - first) / 2;
+			if (predicate(Index(middle)))
+			{
+				first = middle + 1;
+			}
+			else
+			{
+				last = middle;
+			}
+		}
+		return first;
+	}
+
+	// Calls function(first, count) for the contiguous spans of storage holding the
+	// spanCount elements starting offset places after the tail
+	template<typename Function>
+	void ForEachSpan(uint32_t offset, uint32_t spanCount, Function function) const
+	{
+		if (spanCount == 0) return;
+
+		const uint32_t first = Index(offset);
+		const uint32_t firstCount = std::min(spanCount, capacity - first);
+		function(first, firstCount);
+
+		if (spanCount > firstCount)
+		{
+			function(0u, spanCount - firstCount);
+		}
+	}
+
+	template<typename Function>
+	void ForEachSpan(Function function) const { ForEachSpan(0, count, function); }
+
+	// Reallocates every storage to the new capacity, rotated so the tail moves to index 0
+	template<typename... Storages>
+	void Resize(uint32_t newCapacity, Storages&... storages)
+	{
+		newCapacity = std::max(newCapacity, count);
+		if (tail > 0)
+		{
+			(std::rotate(storages.begin(), storages.begin() + tail, storages.begin() + capacity), ...);
+		}
+		(storages.resize(newCapacity), ...);
+
+		tail = 0;
+		capacity = newCapacity;
+	}
+
+	void Clear()
+	{
+		tail = 0;
+		count = 0;
+		capacity = 0;
+	}
+};
\ No newline at end of file
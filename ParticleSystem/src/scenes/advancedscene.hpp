@@ -3,7 +3,7 @@
 #include "scene.hpp"
 #include "../particles/advanced.hpp"
 
-class AdvancedPsScene : public IScene
+class AdvancedPsScene : public IScene, public IPipelined
 {
 	Scoped<advanced::ParticleEmitter> emitter1;
 	Scoped<advanced::ParticleEmitter> emitter2;
@@ -114,6 +114,10 @@ public:
 		//emitter3->SetPosition({ width / 2.0f, height / 2.0f });
 	}
 
+	void SetPipelined(bool isPipelined) override { advanced::manager->SetPipelined(isPipelined); }
+	bool IsPipelined() override { return advanced::manager->IsPipelined(); }
+	void Sync() override { advanced::manager->Sync(); }
+
 	void Update(float time, float dt) override
 	{
 		PROFILE_FUNCTION();
@@ -135,7 +139,7 @@ public:
 		advanced::manager->Update(time, dt);
 	}
 
-	void Draw() override
+	void Draw(float interpolation) override
 	{
 		PROFILE_FUNCTION();
 
@@ -143,10 +147,12 @@ public:
 
 		ClearBackground(RAYWHITE);
 
+		advanced::manager->SetInterpolation(interpolation);
 		advanced::manager->Draw();
 
 		DrawFPS(4, 40);
 		DrawText(GetName(), 4, 4, 40, LIGHTGRAY);
+		DrawMetricsOverlay(4, 110);
 
 		EndDrawing();
 	}
@@ -3,7 +3,7 @@
 #include "scene.hpp"
 #include "../particles/ecs.hpp"
 
-class ECSPSScene : public IScene
+class ECSPSScene : public IScene, public IPipelined
 {
 	Ref<ecs::Entity> emitter1;
 	Ref<ecs::Entity> emitter2;
@@ -70,6 +70,10 @@ public:
 		ecs::Resize(width, height);
 	}
 
+	void SetPipelined(bool isPipelined) override { ecs::SetPipelined(isPipelined); }
+	bool IsPipelined() override { return ecs::IsPipelined(); }
+	void Sync() override { ecs::Sync(); }
+
 	void Update(float time, float dt) override
 	{
 		PROFILE_FUNCTION();
@@ -79,7 +83,7 @@ public:
 		ecs::Update(time, dt);
 	}
 
-	void Draw() override
+	void Draw(float interpolation) override
 	{
 		PROFILE_FUNCTION();
 
@@ -87,10 +91,12 @@ public:
 
 		ClearBackground(RAYWHITE);
 
+		ecs::SetInterpolation(interpolation);
 		ecs::Draw();
 
 		DrawFPS(4, 40);
 		DrawText(GetName(), 4, 4, 40, LIGHTGRAY);
+		DrawMetricsOverlay(4, 110);
 
 		EndDrawing();
 	}
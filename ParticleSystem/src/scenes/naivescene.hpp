@@ -54,7 +54,7 @@ public:
 		particleSystem->Update(time, dt);
 	}
 
-	void Draw() override
+	void Draw(float) override
 	{
 		PROFILE_FUNCTION();
 
@@ -66,6 +66,7 @@ public:
 
 		DrawFPS(4, 40);
 		DrawText(GetName(), 4, 4, 40, LIGHTGRAY);
+		DrawMetricsOverlay(4, 110);
 
 		EndDrawing();
 	}
@@ -2,6 +2,8 @@
 
 #include "../common.hpp"
 #include "../instrumentation.hpp"
+#include "../metrics.hpp"
+#include "../timestep.hpp"
 
 class IScene
 {
@@ -10,7 +12,8 @@ public:
 	virtual void Start() = 0;
 	virtual void Resize(int width, int height) = 0;
 	virtual void Update(float time, float dt) = 0;
-	virtual void Draw() = 0;
+	// Interpolation is the fraction of a simulation step the frame is drawn ahead of the last update
+	virtual void Draw(float interpolation) = 0;
 	virtual ~IScene() = default;
 };
 
@@ -34,6 +37,9 @@ class SceneManager
 	KeyboardKey active;
 	std::unordered_map<KeyboardKey, Scoped<ASceneLoader>> sceneLoadersByKey;
 	std::vector<KeyboardKey> keys;
+	FixedTimestep timestep;
+	float frameTime;
+	bool isProfiling;
 
 	void Switch(KeyboardKey key)
 	{
@@ -47,15 +53,17 @@ class SceneManager
 
 			active = it->first;
 
-			PROFILE_END_SESSION();
+			// A running capture moves on to a file of its own for the new scene
+			if (isProfiling) BeginProfiling();
 
-			const auto name = it->second->GetName();
-			PROFILE_BEGIN_SESSION(TextFormat("%s Scene", name), TextFormat("./%s-scene-profile.json", name));
-			
+			GetMetrics().Clear();
 			sceneLoadersByKey[active]->Load();
 
 			it->second->Get()->Start();
 			it->second->Get()->Resize(GetScreenWidth(), GetScreenHeight());
+
+			// Scenes start their emitters at the current time
+			timestep.Reset((float)GetTime());
 		}
 
 		SetWindowTitle(PrependSolutionName(it->second->GetName()));
@@ -63,15 +71,57 @@ class SceneManager
 
 	void Randomize()
 	{
+		Sync();
+
 		auto randomize = dynamic_cast<IRandomize*>(sceneLoadersByKey[active]->Get());
 		if (randomize) randomize->Randomize();
 	}
 
+	// Scenes change their emitters from the main thread, which a pipelined step may still be reading
+	void Sync()
+	{
+		auto pipelined = dynamic_cast<IPipelined*>(sceneLoadersByKey[active]->Get());
+		if (pipelined) pipelined->Sync();
+	}
+
+	void BeginProfiling()
+	{
+		PROFILE_END_SESSION();
+
+		const auto name = GetActiveSceneName();
+		const auto filepath = TextFormat("./%s-scene-profile-%lld.json", name, (long long)std::time(nullptr));
+		PROFILE_BEGIN_SESSION(TextFormat("%s Scene", name), filepath);
+		InfoLog("Profiling '%s' to %s", name, filepath);
+	}
+
+	void ToggleProfiling()
+	{
+		isProfiling = !isProfiling;
+
+		if (isProfiling)
+		{
+			BeginProfiling();
+		}
+		else
+		{
+			PROFILE_END_SESSION();
+			InfoLog("Profiling stopped");
+		}
+	}
+
+	void TogglePipelined()
+	{
+		auto pipelined = dynamic_cast<IPipelined*>(sceneLoadersByKey[active]->Get());
+		if (pipelined) pipelined->SetPipelined(!pipelined->IsPipelined());
+	}
+
 public:
 	SceneManager() = delete;
 	SceneManager(const SceneManager&) = delete;
 	SceneManager& operator=(const SceneManager&) = delete;
-	SceneManager(std::initializer_list<std::pair<KeyboardKey, ASceneLoader*>> skList)
+	SceneManager(std::initializer_list<std::pair<KeyboardKey, ASceneLoader*>> skList) :
+		frameTime(0.0f),
+		isProfiling(Instrumentor::IsRequestedByEnvironment())
 	{
 		for (auto& pair : skList)
 		{
@@ -85,9 +135,25 @@ public:
 
 	void Resize(int width, int height) { sceneLoadersByKey[active]->Get()->Resize(width, height); }
 
-	void Update(float time, float dt)
+	// Rate the scenes are simulated at, independent of the display refresh rate
+	void SetTimestep(float step, uint32_t maxSubsteps) { timestep.Set(step, maxSubsteps); }
+
+	void Update(float frameTime)
 	{
-		sceneLoadersByKey[active]->Get()->Update(time, dt);
+		this->frameTime = frameTime;
+
+		{
+			METRICS_SCOPE("frame.Update");
+
+			// The last step keeps simulating while the frame is drawn, earlier ones finish before the next
+			uint32_t stepIndex = 0;
+			const auto steps = timestep.Advance(frameTime, [this, &stepIndex](float time, float step)
+				{
+					if (stepIndex++ > 0) Sync();
+					sceneLoadersByKey[active]->Get()->Update(time, step);
+				});
+			METRICS_COUNT("frame.Steps", steps);
+		}
 
 		for (const auto& key : keys)
 		{
@@ -101,7 +167,34 @@ public:
 		{
 			Randomize();
 		}
+
+		if (IsKeyReleased(KEY_P))
+		{
+			TogglePipelined();
+		}
+
+		// Captures a trace of the running scene until pressed again
+		if (IsKeyReleased(KEY_F9))
+		{
+			ToggleProfiling();
+		}
+
+		if (IsKeyReleased(KEY_M))
+		{
+			GetMetrics().SetOverlayVisible(!GetMetrics().IsOverlayVisible());
+		}
 	}
 
-	void Draw() { sceneLoadersByKey[active]->Get()->Draw(); }
+	void Draw()
+	{
+		{
+			METRICS_SCOPE("frame.Draw");
+			sceneLoadersByKey[active]->Get()->Draw(timestep.GetInterpolation());
+		}
+
+		METRICS_TIME("frame.Time", frameTime);
+		GetMetrics().EndFrame(frameTime);
+
+		PROFILE_FRAME_MARK();
+	}
 };
\ No newline at end of file
@@ -36,12 +36,12 @@ public:
 
 		auto sharedData1 = MakeRef<simple::SharedParticleData>();
 		sharedData1->lifeTime = 1.0f;
-		sharedData1->sizeOverLifetime = Ref<Vector2>(new Vector2 { 0.0f, 20.0f });
+		sharedData1->sizeOverLifetime = MakeRef<Curve<float>>(Curve<float>{ { 0.0f, 0.0f }, { 1.0f, 20.0f } });
 		sharedData1->colorOverLifetime = gradient;
 
 		auto sharedData2 = MakeRef<simple::SharedParticleData>();
 		sharedData2->lifeTime = 4.0f;
-		sharedData2->sizeOverLifetime = Ref<Vector2>(new Vector2 { 0.0f, 10.0f });
+		sharedData2->sizeOverLifetime = MakeRef<Curve<float>>(Curve<float>{ { 0.0f, 0.0f }, { 1.0f, 10.0f } });
 		sharedData2->colorOverLifetime = gradient;
 
 		emitter1 = Scoped<simple::ParticleEmitter>(
@@ -97,7 +97,7 @@ public:
 		simple::manager->Update(time, dt);
 	}
 
-	void Draw() override
+	void Draw(float) override
 	{
 		PROFILE_FUNCTION();
 
@@ -109,6 +109,7 @@ public:
 
 		DrawFPS(4, 40);
 		DrawText(GetName(), 4, 4, 40, LIGHTGRAY);
+		DrawMetricsOverlay(4, 110);
 
 		EndDrawing();
 	}
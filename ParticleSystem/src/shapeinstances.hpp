@@ -0,0 +1,101 @@
+#pragma once
+
+#include "common.hpp"
+
+// CPU side of the instanced shape renderer. Shapes are packed into a flat array
+// of fixed size instances which the ShapeBatchRenderer uploads as is, so this
+// layer has no GL dependency and can be verified and benchmarked headless.
+
+// Must match the SHAPE_* constants in shaders/shapebatch.frag
+enum class ShapeType : uint32_t
+{
+	CIRCLE, ELLIPSE, RECT, RECT_GRADIENT, ROUNDED_RECT, RING
+};
+
+// Every shape is described as a quad around its center, shape specific values go into params:
+//	RECT_GRADIENT	x: 1 if horizontal, 0 if vertical
+//	ROUNDED_RECT	x: corner radius in pixels
+//	RING			x: start angle, y: end angle (radians), z: inner / outer radius, w: segments (0 for a circle)
+struct ShapeInstance
+{
+	Vector2 center;
+	Vector2 halfSize;
+	float rotation;
+	ShapeType shape;
+	Vector4 params;
+	Color color;
+	Color secondaryColor;
+};
+
+// Round point sprite of size pixels across, as drawn by the point batch
+struct PointInstance
+{
+	Vector2 position;
+	float size;
+	Color color;
+};
+
+static_assert(sizeof(ShapeInstance) == 48, "ShapeInstance layout is mirrored by the shape batch vertex attributes");
+
+class ShapeInstanceBuffer
+{
+	std::vector<ShapeInstance> instances;
+
+public:
+	ShapeInstanceBuffer() = default;
+	ShapeInstanceBuffer(std::size_t capacity) { instances.reserve(capacity); }
+
+	void Reserve(std::size_t capacity) { instances.reserve(capacity); }
+	void Clear() { instances.clear(); }
+
+	std::size_t Size() const { return instances.size(); }
+	bool IsEmpty() const { return instances.empty(); }
+	const ShapeInstance* Data() const { return instances.data(); }
+	const ShapeInstance& operator[](std::size_t index) const { return instances [index]; }
+
+	// Same placement as DrawCircleV
+	void AddCircle(Vector2 center, float radius, Color color)
+	{
+		instances.push_back({ center, { radius, radius }, 0.0f, ShapeType::CIRCLE, {}, color, color });
+	}
+
+	// Same placement as DrawEllipse
+	void AddEllipse(Vector2 center, Vector2 radii, Color color, float rotation = 0.0f)
+	{
+		instances.push_back({ center, radii, rotation, ShapeType::ELLIPSE, {}, color, color });
+	}
+
+	// Same placement as DrawRectangleV, position is the top left corner
+	void AddRect(Vector2 position, Vector2 size, Color color, float rotation = 0.0f)
+	{
+		const Vector2 halfSize = Vector2Scale(size, 0.5f);
+		instances.push_back({ Vector2Add(position, halfSize), halfSize, rotation, ShapeType::RECT, {}, color, color });
+	}
+
+	// Same placement as DrawRectangleGradientH / DrawRectangleGradientV,
+	// color1 is on the left or top and color2 on the right or bottom
+	void AddRectGradient(Vector2 position, Vector2 size, Color color1, Color color2, bool isHorizontal, float rotation = 0.0f)
+	{
+		const Vector2 halfSize = Vector2Scale(size, 0.5f);
+		const Vector4 params = { isHorizontal ? 1.0f : 0.0f, 0.0f, 0.0f, 0.0f };
+		instances.push_back({ Vector2Add(position, halfSize), halfSize, rotation, ShapeType::RECT_GRADIENT, params, color1, color2 });
+	}
+
+	// Same placement and roundness as DrawRectangleRounded
+	void AddRoundedRect(Vector2 position, Vector2 size, float roundness, Color color, float rotation = 0.0f)
+	{
+		const Vector2 halfSize = Vector2Scale(size, 0.5f);
+		const float radius = Clamp01(roundness) * std::min(halfSize.x, halfSize.y);
+		const Vector4 params = { radius, 0.0f, 0.0f, 0.0f };
+		instances.push_back({ Vector2Add(position, halfSize), halfSize, rotation, ShapeType::ROUNDED_RECT, params, color, color });
+	}
+
+	// Same placement as DrawRing, angles are in degrees. Rings with less than 3
+	// segments are drawn as circles, otherwise as regular polygons like raylib.
+	void AddRing(Vector2 center, float innerRadius, float outerRadius, float startAngle, float endAngle, int segments, Color color)
+	{
+		const float ratio = outerRadius > 0.0f ? innerRadius / outerRadius : 0.0f;
+		const Vector4 params = { startAngle * DEG2RAD, endAngle * DEG2RAD, ratio, segments >= 3 ? (float)segments : 0.0f };
+		instances.push_back({ center, { outerRadius, outerRadius }, 0.0f, ShapeType::RING, params, color, color });
+	}
+};
\ No newline at end of file
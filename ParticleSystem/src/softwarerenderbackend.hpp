@@ -0,0 +1,325 @@
+#pragma once
+
+#include "common.hpp"
+#include "renderbackend.hpp"
+
+// Rasterizes into an RGBA8 framebuffer in memory, so the draw path can be measured
+// and compared against golden images without a GPU. Primitives are binned into
+// square tiles by their bounds, then every tile is rasterized on its own thread,
+// walking its bin in submission order so blending matches the GL backend.
+class SoftwareRenderBackend : public IRenderBackend
+{
+public:
+	static constexpr int TileSize = 64;
+
+private:
+	struct Bounds
+	{
+		int minX, minY, maxX, maxY;
+
+		bool IsEmpty() const { return minX >= maxX || minY >= maxY; }
+	};
+
+	int width, height;
+	int tilesX, tilesY;
+
+	std::vector<Color> framebuffer;
+	std::vector<std::vector<uint32_t>> tileBins;
+	std::vector<uint32_t> tileIndices;
+	std::vector<Bounds> bounds;
+
+	std::vector<PointInstance> points;
+	uint32_t pointCount;
+
+public:
+	SoftwareRenderBackend(int width, int height, uint32_t pointCapacity = 1000000) :
+		width(0),
+		height(0),
+		tilesX(0),
+		tilesY(0),
+		points(pointCapacity),
+		pointCount(0)
+	{
+		Resize(width, height);
+	}
+
+	const char* GetName() const override { return "software"; }
+
+	void Resize(int width, int height) override
+	{
+		this->width = std::max(width, 0);
+		this->height = std::max(height, 0);
+		tilesX = (this->width + TileSize - 1) / TileSize;
+		tilesY = (this->height + TileSize - 1) / TileSize;
+
+		framebuffer.assign((std::size_t)this->width * this->height, BLANK);
+		tileBins.resize((std::size_t)tilesX * tilesY);
+		tileIndices.resize(tileBins.size());
+		std::iota(tileIndices.begin(), tileIndices.end(), 0);
+	}
+
+	int GetWidth() const { return width; }
+	int GetHeight() const { return height; }
+	const Color* Pixels() const { return framebuffer.data(); }
+
+	void Clear(Color color)
+	{
+		std::fill(framebuffer.begin(), framebuffer.end(), color);
+	}
+
+	Span<PointInstance> ReservePoints(uint32_t count) override
+	{
+		if (pointCount == points.size())
+		{
+			FlushPoints();
+		}
+
+		const auto reserved = std::min(count, (uint32_t)points.size() - pointCount);
+		Span<PointInstance> span = { points.data() + pointCount, reserved };
+		pointCount += reserved;
+		return span;
+	}
+
+	void FlushPoints() override
+	{
+		PROFILE_FUNCTION();
+
+		Rasterize(points.data(), pointCount,
+			[](const PointInstance& point)
+			{
+				const float radius = point.size * 0.5f;
+				return Rectangle { point.position.x - radius, point.position.y - radius, point.size, point.size };
+			},
+			[](const PointInstance& point, Vector2 pixel)
+			{
+				return ShadePoint(point, pixel);
+			});
+
+		pointCount = 0;
+	}
+
+	void DrawShapes(const ShapeInstanceBuffer& instances) override
+	{
+		PROFILE_FUNCTION();
+
+		Rasterize(instances.Data(), instances.Size(),
+			[](const ShapeInstance& instance)
+			{
+				// Rotated quad extents plus the anti aliased edge, like shapebatch.vert
+				const float c = std::abs(std::cos(instance.rotation));
+				const float s = std::abs(std::sin(instance.rotation));
+				const float extentX = instance.halfSize.x * c + instance.halfSize.y * s + 1.0f;
+				const float extentY = instance.halfSize.x * s + instance.halfSize.y * c + 1.0f;
+				return Rectangle { instance.center.x - extentX, instance.center.y - extentY, extentX * 2.0f, extentY * 2.0f };
+			},
+			[](const ShapeInstance& instance, Vector2 pixel)
+			{
+				return ShadeShape(instance, pixel);
+			});
+	}
+
+	// Writes the framebuffer as an image, the format follows the file extension
+	bool Export(const char* fileName) const
+	{
+		Image image = { (void*)framebuffer.data(), width, height, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 };
+		return ExportImage(image, fileName);
+	}
+
+	// Number of pixels with a channel differing by more than tolerance from the
+	// golden image, -1 if it can not be loaded or its size differs
+	int64_t Compare(const char* goldenFileName, int tolerance = 0) const
+	{
+		Image golden = LoadImage(goldenFileName);
+		if (!golden.data) return -1;
+
+		ImageFormat(&golden, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+
+		int64_t mismatches = -1;
+		if (golden.width == width && golden.height == height)
+		{
+			// Paired by position, parallel algorithms may pass copies of the pixels so their address is no index
+			const auto goldenPixels = (const Color*)golden.data;
+			mismatches = std::transform_reduce(std::execution::par_unseq, framebuffer.begin(), framebuffer.end(), goldenPixels, int64_t(0), std::plus<>(),
+				[tolerance](const Color& color, const Color& other) -> int64_t
+				{
+					return std::abs(color.r - other.r) > tolerance || std::abs(color.g - other.g) > tolerance
+						|| std::abs(color.b - other.b) > tolerance || std::abs(color.a - other.a) > tolerance;
+				});
+		}
+
+		UnloadImage(golden);
+		return mismatches;
+	}
+
+private:
+	// Coverage is evaluated at pixel centers, colors are blended with
+	// SRC_ALPHA, ONE_MINUS_SRC_ALPHA on every channel like raylib's default blend mode
+	template<typename Primitive, typename BoundsFunction, typename ShadeFunction>
+	void Rasterize(const Primitive* primitives, std::size_t count, BoundsFunction boundsFunction, ShadeFunction shadeFunction)
+	{
+		if (count == 0 || tileBins.empty()) return;
+
+		// Pixel bounds are computed in parallel, binning itself is a cheap serial pass
+		bounds.resize(count);
+		std::transform(std::execution::par_unseq, primitives, primitives + count, bounds.begin(), [this, &boundsFunction](const Primitive& primitive)
+			{
+				const Rectangle rect = boundsFunction(primitive);
+				return Bounds {
+					std::max(0, (int)std::floor(rect.x)),
+					std::max(0, (int)std::floor(rect.y)),
+					std::min(width, (int)std::ceil(rect.x + rect.width)),
+					std::min(height, (int)std::ceil(rect.y + rect.height))
+				};
+			});
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const auto& bound = bounds [i];
+			if (bound.IsEmpty()) continue;
+
+			for (int tileY = bound.minY / TileSize; tileY <= (bound.maxY - 1) / TileSize; tileY++)
+			{
+				for (int tileX = bound.minX / TileSize; tileX <= (bound.maxX - 1) / TileSize; tileX++)
+				{
+					tileBins [tileY * tilesX + tileX].push_back(i);
+				}
+			}
+		}
+
+		std::for_each(std::execution::par_unseq, tileIndices.begin(), tileIndices.end(), [&](uint32_t tile)
+			{
+				auto& bin = tileBins [tile];
+				if (bin.empty()) return;
+
+				const int tileMinX = (tile % tilesX) * TileSize;
+				const int tileMinY = (tile / tilesX) * TileSize;
+				const int tileMaxX = std::min(tileMinX + TileSize, width);
+				const int tileMaxY = std::min(tileMinY + TileSize, height);
+
+				for (const auto index : bin)
+				{
+					const auto& bound = bounds [index];
+					const auto& primitive = primitives [index];
+
+					for (int y = std::max(bound.minY, tileMinY); y < std::min(bound.maxY, tileMaxY); y++)
+					{
+						Color* row = framebuffer.data() + (std::size_t)y * width;
+						for (int x = std::max(bound.minX, tileMinX); x < std::min(bound.maxX, tileMaxX); x++)
+						{
+							const Vector4 source = shadeFunction(primitive, Vector2 { x + 0.5f, y + 0.5f });
+							if (source.w > 0.0f) Blend(row [x], source);
+						}
+					}
+				}
+
+				bin.clear();
+			});
+	}
+
+	static void Blend(Color& destination, const Vector4 source)
+	{
+		const float inverse = 1.0f - source.w;
+		destination.r = (unsigned char)(source.x * source.w * 255.0f + destination.r * inverse + 0.5f);
+		destination.g = (unsigned char)(source.y * source.w * 255.0f + destination.g * inverse + 0.5f);
+		destination.b = (unsigned char)(source.z * source.w * 255.0f + destination.b * inverse + 0.5f);
+		destination.a = (unsigned char)(source.w * source.w * 255.0f + destination.a * inverse + 0.5f);
+	}
+
+	static Vector4 Normalize(Color color)
+	{
+		return Vector4 { color.r / 255.0f, color.g / 255.0f, color.b / 255.0f, color.a / 255.0f };
+	}
+
+	// Same falloff as shaders/pointbatch.frag
+	static Vector4 ShadePoint(const PointInstance& point, Vector2 pixel)
+	{
+		if (point.size <= 0.0f) return {};
+
+		const Vector2 offset = Vector2Scale(Vector2Subtract(pixel, point.position), 1.0f / point.size);
+		const float distance = Vector2DotProduct(offset, offset) * 4.0f;
+		const float t = Clamp01((distance - 0.99f) / 0.02f);
+
+		Vector4 color = Normalize(point.color);
+		color.w *= 1.0f - t * t * (3.0f - 2.0f * t);
+		return color;
+	}
+
+	// Same signed distance fields as shaders/shapebatch.frag
+	static float Box(Vector2 p, Vector2 halfSize)
+	{
+		const float dx = std::abs(p.x) - halfSize.x;
+		const float dy = std::abs(p.y) - halfSize.y;
+		const float outside = Vector2Length({ std::max(dx, 0.0f), std::max(dy, 0.0f) });
+		return outside + std::min(std::max(dx, dy), 0.0f);
+	}
+
+	static float Ring(Vector2 p, float outerRadius, const Vector4& params)
+	{
+		const float startAngle = params.x;
+		const float endAngle = params.y;
+		const float innerRadius = params.z * outerRadius;
+		const float segments = params.w;
+
+		float angle = std::fmod(std::atan2(p.y, p.x) - startAngle, 2.0f * PI);
+		if (angle < 0.0f) angle += 2.0f * PI;
+		if (angle > endAngle - startAngle) return 1.0f;
+
+		float scale = 1.0f;
+		if (segments >= 3.0f)
+		{
+			const float step = 2.0f * PI / segments;
+			scale = std::cos(step * 0.5f) / std::cos(std::fmod(angle, step) - step * 0.5f);
+		}
+
+		const float distance = Vector2Length(p);
+		return std::max(distance - outerRadius * scale, innerRadius * scale - distance);
+	}
+
+	static Vector4 ShadeShape(const ShapeInstance& instance, Vector2 pixel)
+	{
+		// Into the local space of the quad
+		Vector2 local = Vector2Subtract(pixel, instance.center);
+		if (instance.rotation != 0.0f) local = Vector2Rotate(local, -instance.rotation);
+		const Vector2 halfSize = instance.halfSize;
+
+		Vector4 fill = Normalize(instance.color);
+		float distance;
+
+		switch (instance.shape)
+		{
+		case ShapeType::CIRCLE:
+			distance = Vector2Length(local) - halfSize.x;
+			break;
+		case ShapeType::ELLIPSE:
+			distance = halfSize.x > 0.0f && halfSize.y > 0.0f
+				? (Vector2Length({ local.x / halfSize.x, local.y / halfSize.y }) - 1.0f) * std::min(halfSize.x, halfSize.y)
+				: 1.0f;
+			break;
+		case ShapeType::RECT:
+			distance = Box(local, halfSize);
+			break;
+		case ShapeType::RECT_GRADIENT:
+		{
+			distance = Box(local, halfSize);
+			const float t = instance.params.x > 0.5f
+				? Clamp01(halfSize.x > 0.0f ? local.x / (2.0f * halfSize.x) + 0.5f : 0.0f)
+				: Clamp01(halfSize.y > 0.0f ? local.y / (2.0f * halfSize.y) + 0.5f : 0.0f);
+			const Vector4 secondary = Normalize(instance.secondaryColor);
+			fill = { Lerp(fill.x, secondary.x, t), Lerp(fill.y, secondary.y, t), Lerp(fill.z, secondary.z, t), Lerp(fill.w, secondary.w, t) };
+			break;
+		}
+		case ShapeType::ROUNDED_RECT:
+		{
+			const float radius = instance.params.x;
+			distance = Box(local, { halfSize.x - radius, halfSize.y - radius }) - radius;
+			break;
+		}
+		default:
+			distance = Ring(local, halfSize.x, instance.params);
+			break;
+		}
+
+		fill.w *= Clamp01(0.5f - distance);
+		return fill;
+	}
+};
\ No newline at end of file
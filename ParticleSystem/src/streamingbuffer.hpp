@@ -0,0 +1,184 @@
+#pragma once
+
+#include "common.hpp"
+
+// Vertex buffer split into N regions that are written in turn, so the CPU never
+// writes into the region a previous draw may still be reading.
+//	PERSISTENT	The buffer is mapped once, each region is guarded by a fence
+//	ORPHAN		Regions are mapped unsynchronized, the storage is orphaned on wrap around
+//	CPU			Regions live in plain memory and are uploaded when a vbo is bound,
+//				without one no GL call is made so the rotation can run headless
+class StreamingBuffer
+{
+public:
+	enum class Mode
+	{
+		PERSISTENT, ORPHAN, CPU
+	};
+
+	static const char* Stringify(Mode mode)
+	{
+		switch (mode)
+		{
+		case Mode::PERSISTENT: return "Persistent";
+		case Mode::ORPHAN: return "Orphan";
+		default: return "CPU";
+		}
+	}
+
+	static Mode DefaultMode()
+	{
+		return GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage ? Mode::PERSISTENT : Mode::ORPHAN;
+	}
+
+private:
+	Mode mode;
+	uint32_t vbo;
+	uint32_t regionCount;
+	std::size_t regionSize;
+	uint32_t region;
+
+	uint8_t* mapped;
+	std::vector<uint8_t> storage;
+	std::vector<GLsync> fences;
+
+	// Non copyable & moveable
+	StreamingBuffer(const StreamingBuffer&) = delete;
+	StreamingBuffer& operator=(const StreamingBuffer&) = delete;
+
+public:
+	// The vbo must be bound, it is given its storage here
+	StreamingBuffer(uint32_t vbo, std::size_t regionSize, uint32_t regionCount = 3, Mode mode = DefaultMode()) :
+		mode(mode),
+		vbo(vbo),
+		regionCount(regionCount),
+		regionSize(regionSize),
+		region(0),
+		mapped(nullptr),
+		fences(regionCount, nullptr)
+	{
+		const auto size = (GLsizeiptr)(regionSize * regionCount);
+
+		switch (mode)
+		{
+		case Mode::PERSISTENT:
+		{
+			const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+			mapped = (uint8_t*)glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+			break;
+		}
+		case Mode::ORPHAN:
+			glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
+			break;
+		case Mode::CPU:
+			storage.resize(size);
+			if (vbo) glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
+			break;
+		}
+	}
+
+	~StreamingBuffer()
+	{
+		for (auto& fence : fences)
+		{
+			if (fence) glDeleteSync(fence);
+		}
+
+		if (mode == Mode::PERSISTENT && mapped)
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, vbo);
+			glUnmapBuffer(GL_ARRAY_BUFFER);
+		}
+	}
+
+	Mode GetMode() const { return mode; }
+	uint32_t RegionCount() const { return regionCount; }
+	std::size_t RegionSize() const { return regionSize; }
+
+	// Index of the region handed out by the next Begin
+	uint32_t Region() const { return region; }
+
+	// Byte offset of the current region inside the buffer
+	std::size_t Offset() const { return region * regionSize; }
+
+	// Returns the current region for writing, waiting for the GPU if it still reads from it
+	void* Begin()
+	{
+		switch (mode)
+		{
+		case Mode::PERSISTENT:
+			WaitForRegion();
+			return mapped + Offset();
+
+		case Mode::ORPHAN:
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+			// Starting over gives the buffer new storage, the driver keeps the old one alive for pending draws
+			if (region == 0) glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(regionSize * regionCount), nullptr, GL_STREAM_DRAW);
+
+			const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+			return glMapBufferRange(GL_ARRAY_BUFFER, (GLintptr)Offset(), (GLsizeiptr)regionSize, flags);
+		}
+
+		default:
+			return storage.data() + Offset();
+		}
+	}
+
+	// Makes the first size bytes written to the current region visible to the GPU
+	void End(std::size_t size)
+	{
+		switch (mode)
+		{
+		case Mode::ORPHAN:
+			glBindBuffer(GL_ARRAY_BUFFER, vbo);
+			glUnmapBuffer(GL_ARRAY_BUFFER);
+			break;
+
+		case Mode::CPU:
+			if (vbo && size > 0)
+			{
+				glBindBuffer(GL_ARRAY_BUFFER, vbo);
+				glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)Offset(), (GLsizeiptr)size, storage.data() + Offset());
+			}
+			break;
+
+		default:
+			// Coherent mappings need no flush
+			break;
+		}
+	}
+
+	// Called after the draw reading the current region was issued, moves on to the next region
+	void Advance()
+	{
+		if (mode == Mode::PERSISTENT)
+		{
+			if (fences [region]) glDeleteSync(fences [region]);
+			fences [region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		}
+
+		region = (region + 1) % regionCount;
+	}
+
+private:
+	void WaitForRegion()
+	{
+		auto& fence = fences [region];
+		if (!fence) return;
+
+		// Flush once so the fence is guaranteed to signal, then wait in 1ms steps
+		GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+		while (true)
+		{
+			const auto result = glClientWaitSync(fence, flags, 1000000);
+			if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED) break;
+			flags = 0;
+		}
+
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+};
\ No newline at end of file
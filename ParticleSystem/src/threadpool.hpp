@@ -0,0 +1,85 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+// Fixed set of worker threads that live as long as the pool, tasks are
+// picked up in submission order by whichever worker is free.
+class ThreadPool
+{
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> tasks;
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool isRunning;
+
+	// Non copyable & moveable
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+public:
+	static uint32_t DefaultWorkerCount()
+	{
+		const auto hardwareThreads = std::thread::hardware_concurrency();
+		return hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	ThreadPool(uint32_t workerCount = DefaultWorkerCount()) :
+		isRunning(true)
+	{
+		workers.reserve(workerCount);
+		for (uint32_t i = 0; i < workerCount; i++)
+		{
+			workers.emplace_back([this] { WorkerLoop(); });
+		}
+	}
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard lock(mutex);
+			isRunning = false;
+		}
+		condition.notify_all();
+
+		for (auto& worker : workers)
+		{
+			worker.join();
+		}
+	}
+
+	uint32_t Size() const { return (uint32_t)workers.size(); }
+
+	void Submit(std::function<void()> task)
+	{
+		{
+			std::lock_guard lock(mutex);
+			tasks.push_back(std::move(task));
+		}
+		condition.notify_one();
+	}
+
+private:
+	void WorkerLoop()
+	{
+		while (true)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock lock(mutex);
+				condition.wait(lock, [this] { return !isRunning || !tasks.empty(); });
+
+				// Drain the queue before shutting down
+				if (tasks.empty()) return;
+
+				task = std::move(tasks.front());
+				tasks.pop_front();
+			}
+			task();
+		}
+	}
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "common.hpp"
+
+// Turns variable frame times into whole fixed size simulation steps. Time left
+// over is carried into the next frame and exposed as the interpolation factor,
+// the fraction of a step the displayed frame is ahead of the last simulated one.
+// Frames needing more than maxSubsteps steps drop the excess instead of trying
+// to catch up, so a spike can not make the following frames slower still.
+class FixedTimestep
+{
+	float step;
+	uint32_t maxSubsteps;
+	float accumulator;
+	float time;
+
+public:
+	FixedTimestep(float step = 1.0f / 60.0f, uint32_t maxSubsteps = 4) :
+		step(step),
+		maxSubsteps(maxSubsteps),
+		accumulator(0.0f),
+		time(0.0f)
+	{
+	}
+
+	float GetStep() const { return step; }
+	uint32_t GetMaxSubsteps() const { return maxSubsteps; }
+
+	void Set(float step, uint32_t maxSubsteps)
+	{
+		this->step = step;
+		this->maxSubsteps = std::max(maxSubsteps, 1u);
+		accumulator = std::min(accumulator, step);
+	}
+
+	// Restarts the simulated clock at time
+	void Reset(float time)
+	{
+		this->time = time;
+		accumulator = 0.0f;
+	}
+
+	// Simulated time of the next step
+	float GetTime() const { return time; }
+
+	// Fraction of a step in [0, 1] elapsed since the last simulated step
+	float GetInterpolation() const { return accumulator / step; }
+
+	// Calls update(time, step) once per whole step contained in the accumulated frame time
+	template<typename Function>
+	uint32_t Advance(float frameTime, Function update)
+	{
+		accumulator += std::max(frameTime, 0.0f);
+
+		auto steps = (uint32_t)(accumulator / step);
+		if (steps > maxSubsteps)
+		{
+			accumulator -= (steps - maxSubsteps) * step;
+			steps = maxSubsteps;
+		}
+
+		for (uint32_t i = 0; i < steps; i++)
+		{
+			update(time, step);
+			time += step;
+			accumulator -= step;
+		}
+
+		// Guards against rounding leaving a full step behind
+		accumulator = Clamp(accumulator, 0.0f, step);
+		return steps;
+	}
+};
\ No newline at end of file